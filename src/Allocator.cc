@@ -0,0 +1,208 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <boost/assert.hpp>
+
+#include "Allocator.h"
+
+namespace bson {
+
+namespace {
+
+// Allocations are aligned to this, the size of the largest bson scalars.
+const size_t kAlignment = 8;
+
+inline size_t alignUp(size_t n) {
+  return (n + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+// Each buffer of a BufferPool is preceded by a header recording its capacity,
+// large enough to keep the buffer aligned as malloc does.
+const size_t kPoolHeaderSize = 16;
+
+inline size_t &capacityOf(void *p) {
+  return *reinterpret_cast<size_t *>(static_cast<char *>(p) -
+                                     kPoolHeaderSize);
+}
+
+inline size_t capacityOf(const void *p) {
+  return *reinterpret_cast<const size_t *>(static_cast<const char *>(p) -
+                                           kPoolHeaderSize);
+}
+
+inline size_t sizeClassOf(size_t size) {
+  size_t c = BufferPool::kMinBufferSize;
+  while (c < size)
+    c <<= 1;
+  return c;
+}
+
+char *newPoolBuffer(size_t capacity) {
+  char *b = static_cast<char *>(malloc(kPoolHeaderSize + capacity));
+  BOOST_ASSERT_MSG(b != nullptr, "out of memory in BufferPool::Allocate");
+  b += kPoolHeaderSize;
+  capacityOf(b) = capacity;
+  return b;
+}
+
+inline void freePoolBuffer(void *p) {
+  free(static_cast<char *>(p) - kPoolHeaderSize);
+}
+
+// Set once the pool of the thread is destroyed, buffers released by the
+// thread afterwards are freed instead. It's trivially destructible, so it's
+// still valid while the other thread_local objects are being destroyed.
+thread_local bool tlsPoolDestroyed = false;
+
+struct LocalPool : BufferPool {
+  ~LocalPool() override {
+    tlsPoolDestroyed = true;
+  }
+};
+
+}  // namespace
+
+char *Arena::newBlock(size_t size) {
+  size_t header = alignUp(sizeof(Block));
+  Block *b = static_cast<Block *>(malloc(header + size));
+  BOOST_ASSERT_MSG(b != nullptr, "out of memory in Arena::newBlock");
+  b->next = blocks_;
+  blocks_ = b;
+  allocated_ += header + size;
+  return reinterpret_cast<char *>(b) + header;
+}
+
+void *Arena::Allocate(size_t size) {
+  size = alignUp(size);
+  if (size > static_cast<size_t>(end_ - cur_)) {
+    // Large allocations get a block of their own, so that the free space of
+    // the current block isn't wasted.
+    if (size > blockSize_ / 4) {
+      last_ = nullptr;
+      return newBlock(size);
+    }
+
+    cur_ = newBlock(blockSize_);
+    end_ = cur_ + blockSize_;
+  }
+
+  last_ = cur_;
+  cur_ += size;
+  return last_;
+}
+
+void *Arena::Reallocate(void *p, size_t oldSize, size_t newSize) {
+  if (p == nullptr)
+    return Allocate(newSize);
+
+  if (p == last_ && alignUp(newSize) <= static_cast<size_t>(end_ - last_)) {
+    cur_ = last_ + alignUp(newSize);
+    return p;
+  }
+
+  void *ret = Allocate(newSize);
+  memcpy(ret, p, oldSize < newSize ? oldSize : newSize);
+  return ret;
+}
+
+void Arena::Clear() {
+  while (blocks_) {
+    Block *next = blocks_->next;
+    free(blocks_);
+    blocks_ = next;
+  }
+  cur_ = end_ = last_ = nullptr;
+  allocated_ = 0;
+}
+
+BufferPool::~BufferPool() {
+  for (size_t i = 0; i < numFree_; i++)
+    freePoolBuffer(free_[i]);
+}
+
+BufferPool *BufferPool::Local() {
+  static thread_local LocalPool pool;
+  return &pool;
+}
+
+void *BufferPool::Allocate(size_t size) {
+  // best fit
+  size_t best = numFree_;
+  for (size_t i = 0; i < numFree_; i++) {
+    size_t cap = capacityOf(free_[i]);
+    if (cap >= size && (best == numFree_ || cap < capacityOf(free_[best])))
+      best = i;
+  }
+
+  if (best == numFree_)
+    return newPoolBuffer(sizeClassOf(size));
+
+  char *p = free_[best];
+  free_[best] = free_[--numFree_];
+  freeBytes_ -= capacityOf(p);
+  return p;
+}
+
+void *BufferPool::Reallocate(void *p, size_t oldSize, size_t newSize) {
+  if (p == nullptr)
+    return Allocate(newSize);
+
+  if (newSize <= capacityOf(p))
+    return p;
+
+  size_t cap = sizeClassOf(newSize);
+  char *b = static_cast<char *>(
+      realloc(static_cast<char *>(p) - kPoolHeaderSize, kPoolHeaderSize + cap));
+  BOOST_ASSERT_MSG(b != nullptr, "out of memory in BufferPool::Reallocate");
+  b += kPoolHeaderSize;
+  capacityOf(b) = cap;
+  return b;
+}
+
+void BufferPool::Deallocate(void *p) {
+  if (p == nullptr)
+    return;
+
+  size_t cap = capacityOf(p);
+  if (numFree_ < kMaxBuffers && cap <= kMaxBufferSize &&
+      freeBytes_ + cap <= kMaxPoolSize) {
+    free_[numFree_++] = static_cast<char *>(p);
+    freeBytes_ += cap;
+  } else {
+    freePoolBuffer(p);
+  }
+}
+
+void BufferPool::Recycle(void *p) {
+  if (tlsPoolDestroyed)
+    freePoolBuffer(p);
+  else
+    Local()->Deallocate(p);
+}
+
+size_t BufferPool::CapacityOf(const void *p) {
+  return capacityOf(p);
+}
+
+}  // namespace bson
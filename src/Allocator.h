@@ -22,14 +22,154 @@
 
 #pragma once
 
-#include <folly/Arena.h>
-#include <memory>
+#include <cstddef>
+
+#include "DisallowCopying.h"
 
 namespace bson {
 
-using folly::SysArena;
-using folly::SysAlloc;
+// Allocator is where BufBuilder obtains its buffer from. When none is given,
+// BufBuilder uses malloc/realloc/free directly.
+class Allocator {
+ public:
+  virtual ~Allocator() = default;
+
+  virtual void *Allocate(size_t size) = 0;
+
+  // Grow the block "p" of "oldSize" bytes to "newSize" bytes, keeping its
+  // content. The block may be moved.
+  virtual void *Reallocate(void *p, size_t oldSize, size_t newSize) = 0;
+
+  virtual void Deallocate(void *p) = 0;
+};
+
+// Arena is a bump allocator: memory is carved out of large blocks, and all of
+// it is freed at once when the arena is destroyed (or cleared), rather than
+// piece by piece.
+//
+// It's meant for request- or batch-scoped workloads: the documents built with
+// ObjectBuilder(Arena *) during a request all live in the request's arena,
+// and the Objects referring to them carry no reference count, so they must
+// not outlive the arena.
+//
+// Arena is not thread-safe.
+class Arena : public Allocator {
+  __DISALLOW_COPYING__(Arena);
+
+ public:
+  enum { kDefaultBlockSize = 64 * 1024 };
+
+  explicit Arena(size_t blockSize = kDefaultBlockSize)
+      : blockSize_(blockSize),
+        blocks_(nullptr),
+        cur_(nullptr),
+        end_(nullptr),
+        last_(nullptr),
+        allocated_(0) {}
+
+  ~Arena() override {
+    Clear();
+  }
+
+  void *Allocate(size_t size) override;
+
+  // Grows in place if "p" is the latest allocation and the current block has
+  // room for it, which is the common case of a single BufBuilder growing.
+  void *Reallocate(void *p, size_t oldSize, size_t newSize) override;
+
+  // Memory is only freed along with the arena.
+  void Deallocate(void *) override {}
+
+  // Free all the memory of the arena. Everything allocated from it becomes
+  // invalid.
+  void Clear();
+
+  // @return the total size of the blocks obtained from the system.
+  size_t BytesAllocated() const {
+    return allocated_;
+  }
+
+ private:
+  struct Block {
+    Block *next;
+  };
+
+  // Allocate a block with room for "size" bytes.
+  char *newBlock(size_t size);
+
+ private:
+  const size_t blockSize_;
+  Block *blocks_;  // list of all blocks, the latest first
+  char *cur_;      // free space of the current block
+  char *end_;
+  char *last_;     // the latest allocation
+  size_t allocated_;
+};
+
+// BufferPool keeps the buffers released by the builders, so that building
+// document after document doesn't go to malloc for each of them.
+//
+// Buffers are handed out in power-of-two size classes. A request is served by
+// the smallest free buffer that is large enough, so a pool warmed up by
+// documents of a similar size keeps giving out buffers of that size. At most
+// kMaxBuffers buffers of up to kMaxBufferSize bytes each, and kMaxPoolSize
+// bytes in all, are kept, the others are freed right away.
+//
+// The Objects built with ObjectBuilder(BufferPool *) give their buffer back
+// to the pool of the thread dropping the last reference to them, by the
+// Recycle deleter.
+//
+// BufferPool is not thread-safe, each thread has its own, @see Local().
+class BufferPool : public Allocator {
+  __DISALLOW_COPYING__(BufferPool);
+
+ public:
+  enum {
+    kMinBufferSize = 512,
+    kMaxBufferSize = 1024 * 1024,
+    kMaxBuffers = 8,
+    kMaxPoolSize = 4 * 1024 * 1024
+  };
+
+  BufferPool() : numFree_(0), freeBytes_(0) {}
+
+  ~BufferPool() override;
+
+  // @return the pool of the calling thread.
+  static BufferPool *Local();
+
+  void *Allocate(size_t size) override;
+
+  // Grows in place as long as the size class of "p" has room for it.
+  void *Reallocate(void *p, size_t oldSize, size_t newSize) override;
+
+  // Keep "p" for later allocations, unless the pool is full or "p" is too
+  // large to be worth keeping.
+  void Deallocate(void *p) override;
+
+  // Release function of the SharedBuffers adopting a buffer allocated from a
+  // pool. The buffer goes to the pool of the calling thread, or is freed if
+  // that pool has already been destroyed.
+  static void Recycle(void *p);
+
+  // @return the size of the buffer "p" allocated from a pool, which is
+  // rounded up to its size class.
+  static size_t CapacityOf(const void *p);
+
+  // @return the number of buffers kept for reuse.
+  size_t NumFreeBuffers() const {
+    return numFree_;
+  }
+
+  // @return the total size of the buffers kept for reuse.
+  size_t FreeBytes() const {
+    return freeBytes_;
+  }
 
-template <class T> folly::StlAllocator<std::allocator, T> StlAllocator;
+ private:
+  char *free_[kMaxBuffers];
+  size_t numFree_;
+  size_t freeBytes_;
+};
 
-}  // namespace bson
\ No newline at end of file
+}  // namespace bson
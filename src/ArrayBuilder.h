@@ -0,0 +1,76 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "ObjectBuilder.h"
+#include "internal/ArrayKeys.h"
+
+namespace bson {
+
+// ArrayBuilder appends the elements of an array to an ObjectBuilder, keyed
+// by their indexes "0", "1", ... as BSON requires:
+//
+//   ObjectBuilder builder;
+//   ArrayBuilder a(builder.BeginSubArray("a"));
+//   a.Append(1).Append(Slice("two"));
+//   a.BeginSubObject().Append("three", 3).EndSubObject();
+//   builder.EndSubArray();
+//
+// Elements of any type ObjectBuilder::Append takes can be appended. For the
+// others, use NextKey() as the field name of an ObjectBuilder call.
+//
+class ArrayBuilder {
+  __DISALLOW_COPYING__(ArrayBuilder);
+
+ public:
+  // @param builder where the elements are appended, positioned in an array,
+  // e.g right after BeginSubArray, or at the root of an array document.
+  explicit ArrayBuilder(ObjectBuilder &builder) : builder_(builder) {}
+
+  template <class T> ArrayBuilder &Append(const T &val) {
+    builder_.Append(keys_.Next(), val);
+    return *this;
+  }
+
+  // Begin an embedded object or array as the next element, to be ended by
+  // ObjectBuilder::EndSubObject or EndSubArray.
+  ObjectBuilder &BeginSubObject() {
+    return builder_.BeginSubObject(keys_.Next());
+  }
+
+  ObjectBuilder &BeginSubArray() {
+    return builder_.BeginSubArray(keys_.Next());
+  }
+
+  // @return the key of the next element, which is valid until the next call.
+  Slice NextKey() {
+    return keys_.Next();
+  }
+
+  // @return the number of elements appended so far.
+  size_t Count() const {
+    return keys_.Count();
+  }
+
+ private:
+  ObjectBuilder &builder_;
+  internal::ArrayKeys keys_;
+};
+
+}  // namespace bson
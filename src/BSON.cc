@@ -19,11 +19,54 @@
 
 #include "BSON.h"
 #include "Parser.h"
+#include "StructuralParser.h"
 
 namespace bson {
 
+namespace {
+
+// Learns the size of the objects parsed on the thread, @see SizeHint.
+thread_local SizeHint tlsFromJSONHint;
+
+}  // namespace
+
+// The objects parsed on a thread are built in buffers recycled by the pool of
+// the thread, starting with room for objects of the size recently parsed. An
+// object leaving most of its buffer unused is copied out of it, @see
+// ObjectBuilder::Obj.
 Object FromJSON(Slice json) {
-  ObjectBuilder builder;
+  ObjectBuilder builder(BufferPool::Local(), tlsFromJSONHint.Get());
+  Parser parser(json);
+
+  Status s;
+  if (!(s = parser.Parse(builder))) {
+    LOG(FATAL) << s.ToString();
+  }
+
+  Object obj = builder.Done();
+  tlsFromJSONHint.Update(obj.TotalSize());
+  return obj;
+}
+
+Object FromJSON(Slice json, ParserEngine_t engine) {
+  if (engine == kRecursiveDescent)
+    return FromJSON(json);
+
+  ObjectBuilder builder(BufferPool::Local(), tlsFromJSONHint.Get());
+  StructuralParser parser(json);
+
+  Status s;
+  if (!(s = parser.Parse(builder))) {
+    LOG(FATAL) << s.ToString();
+  }
+
+  Object obj = builder.Done();
+  tlsFromJSONHint.Update(obj.TotalSize());
+  return obj;
+}
+
+Object FromJSON(Slice json, Arena *arena) {
+  ObjectBuilder builder(arena);
   Parser parser(json);
 
   Status s;
@@ -34,4 +77,24 @@ Object FromJSON(Slice json) {
   return builder.Done();
 }
 
+std::string ToJSON(const Object &bson) {
+  return ToJSON(bson, kCompact);
+}
+
+std::string ToJSON(const Object &bson, JSONFormat_t format) {
+  // The writers are reused by later calls on the same thread, along with
+  // their output buffers.
+  static thread_local JSONWriter compact(kCompact), pretty(kPretty);
+
+  JSONWriter &writer = (format == kPretty) ? pretty : compact;
+  return writer.Write(bson).ToString();
+}
+
+Status ToJSON(const Object &bson, JSONSink *sink, JSONFormat_t format) {
+  // The sink may call ToJSON itself, so the thread-local writers are not
+  // used here.
+  JSONWriter writer(format);
+  return writer.Write(bson, sink);
+}
+
 }  // namespace bson
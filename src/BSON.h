@@ -17,13 +17,39 @@
 
 #pragma once
 
+#include "JSONWriter.h"
 #include "Slice.h"
 #include "Object.h"
 
 namespace bson {
 
+// Engines available for parsing json.
+enum ParserEngine_t {
+  // The recursive-descent Parser, which also accepts the extended syntax
+  // like single-quoted strings, NumberInt(...) and Datetime(...).
+  kRecursiveDescent = 0,
+
+  // The two-stage StructuralParser, which only accepts strict json plus NaN,
+  // Infinity and -Infinity, and the lenient number grammar of Parser, e.g.
+  // "+1", ".5" and "1.". @see StructuralParser.
+  kStructuralIndex = 1,
+};
+
 extern Object FromJSON(Slice json);
 
+extern Object FromJSON(Slice json, ParserEngine_t engine);
+
+// Build the object in "arena", @see ObjectBuilder(Arena *).
+extern Object FromJSON(Slice json, Arena *arena);
+
+// Serialize "bson" into compact json.
 extern std::string ToJSON(const Object &bson);
 
+extern std::string ToJSON(const Object &bson, JSONFormat_t format);
+
+// Serialize "bson" into "sink" chunk by chunk, without holding the whole
+// json text in memory. @see JSONWriter
+extern Status ToJSON(const Object &bson, JSONSink *sink,
+                     JSONFormat_t format = kCompact);
+
 }  // namespace bson
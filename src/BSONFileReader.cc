@@ -0,0 +1,162 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "BSONFileReader.h"
+
+namespace bson {
+
+static Status errnoStatus(const std::string &context, int err) {
+  return Status::IOError(context + ": " + strerror(err));
+}
+
+Status BSONFileReader::Open(const std::string &path, Access_t access,
+                            bool index) {
+  Close();
+
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return errnoStatus("open " + path, errno);
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    Status s = errnoStatus("fstat " + path, errno);
+    ::close(fd);
+    return s;
+  }
+
+  size_t size = static_cast<size_t>(st.st_size);
+  void *addr = nullptr;
+
+  // mmap(2) refuses empty mappings, there's nothing to map anyway.
+  if (size > 0) {
+    addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      Status s = errnoStatus("mmap " + path, errno);
+      ::close(fd);
+      return s;
+    }
+    ::madvise(addr, size,
+              access == kRandom ? MADV_RANDOM : MADV_SEQUENTIAL);
+  }
+
+  // The mapping stays valid after the descriptor is closed.
+  ::close(fd);
+
+  open_ = true;
+  data_ = static_cast<const char *>(addr);
+  size_ = size;
+  indexOnNext_ = index;
+  return Status::OK();
+}
+
+void BSONFileReader::Close() {
+  if (data_)
+    ::munmap(const_cast<char *>(data_), size_);
+  open_ = false;
+  data_ = nullptr;
+  size_ = 0;
+  pos_ = 0;
+  status_ = Status::OK();
+  indexOnNext_ = false;
+  offsets_.clear();
+  indexEnd_ = 0;
+}
+
+Status BSONFileReader::readAt(size_t offset, ObjectView *doc) const {
+  const size_t kMinSize = 5;  // totalSize + EOO
+
+  size_t remain = size_ - offset;
+  if (remain < kMinSize) {
+    return Status::Corruption("truncated document at offset " +
+                              std::to_string(offset));
+  }
+
+  int len = ConstDataView(data_ + offset).ReadNum<int>();
+  if (len < static_cast<int>(kMinSize) || static_cast<size_t>(len) > remain) {
+    return Status::Corruption("invalid document size " + std::to_string(len) +
+                              " at offset " + std::to_string(offset));
+  }
+
+  if (data_[offset + len - 1] != '\0') {
+    return Status::Corruption("missing EOO of the document at offset " +
+                              std::to_string(offset));
+  }
+
+  *doc = ObjectView(data_ + offset);
+  return Status::OK();
+}
+
+bool BSONFileReader::Next(ObjectView *doc) {
+  if (!status_ || pos_ >= size_)
+    return false;
+
+  status_ = readAt(pos_, doc);
+  if (!status_)
+    return false;
+
+  if (indexOnNext_ && pos_ == indexEnd_) {
+    offsets_.push_back(pos_);
+    indexEnd_ += doc->TotalSize();
+  }
+  pos_ += doc->TotalSize();
+  return true;
+}
+
+Status BSONFileReader::extendIndex(size_t n) {
+  ObjectView doc;
+  while (offsets_.size() < n && indexEnd_ < size_) {
+    Status s = readAt(indexEnd_, &doc);
+    if (!s)
+      return s;
+    offsets_.push_back(indexEnd_);
+    indexEnd_ += doc.TotalSize();
+  }
+  return Status::OK();
+}
+
+Status BSONFileReader::Get(size_t n, ObjectView *doc) {
+  Status s = extendIndex(n + 1);
+  if (!s)
+    return s;
+
+  if (n >= offsets_.size()) {
+    return Status::IOError("document " + std::to_string(n) +
+                           " is past the end of file, which has " +
+                           std::to_string(offsets_.size()) + " documents");
+  }
+
+  *doc = ObjectView(data_ + offsets_[n]);
+  return Status::OK();
+}
+
+Status BSONFileReader::NumDocuments(size_t *n) {
+  Status s = extendIndex(static_cast<size_t>(-1));
+  if (!s)
+    return s;
+  *n = offsets_.size();
+  return Status::OK();
+}
+
+}  // namespace bson
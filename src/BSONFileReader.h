@@ -0,0 +1,128 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "DisallowCopying.h"
+#include "Object.h"
+#include "Status.h"
+
+namespace bson {
+
+// BSONFileReader reads a .bson dump file, i.e BSON objects simply
+// concatenated one after another, as mongodump writes them.
+//
+// The file is mmapped rather than read into heap buffers, so opening it costs
+// nothing no matter how large it is, and the documents are returned as
+// ObjectViews pointing into the mapping. The views are valid until the
+// reader is closed; use ObjectView::Own() to keep a document longer than
+// that.
+//
+// Usage:
+//
+//  BSONFileReader reader;
+//  Status s = reader.Open("dump.bson");
+//  ObjectView doc;
+//  while (reader.Next(&doc)) { ... }
+//  if (!reader.status()) { ... }
+//
+class BSONFileReader {
+  __DISALLOW_COPYING__(BSONFileReader);
+
+ public:
+  // Hints passed to madvise(2) for the mapping.
+  enum Access_t { kSequential = 0, kRandom = 1 };
+
+  BSONFileReader()
+      : open_(false),
+        data_(nullptr),
+        size_(0),
+        pos_(0),
+        indexOnNext_(false),
+        indexEnd_(0) {}
+
+  ~BSONFileReader() {
+    Close();
+  }
+
+  // Map the file at "path". If "index" is set, Next records the offset of
+  // every document it reads, so that the documents can be accessed randomly
+  // with Get after the first pass at no additional cost.
+  Status Open(const std::string &path, Access_t access = kSequential,
+              bool index = false);
+
+  void Close();
+
+  bool IsOpen() const {
+    return open_;
+  }
+
+  // Read the next document into "doc".
+  // @return false at the end of file, or if the document is malformed, in
+  // which case status() tells why.
+  bool Next(ObjectView *doc);
+
+  // Start over from the first document, clearing the error of the previous
+  // pass if any.
+  void Rewind() {
+    pos_ = 0;
+    status_ = Status::OK();
+  }
+
+  const Status &status() const {
+    return status_;
+  }
+
+  // Read the Nth document. Documents the index doesn't cover yet are
+  // scanned first, so the first call may take O(n) time, and all the others
+  // O(1).
+  Status Get(size_t n, ObjectView *doc);
+
+  // Count the documents in the file, indexing all of them.
+  Status NumDocuments(size_t *n);
+
+  // @return the mapped file.
+  Slice Data() const {
+    return Slice(data_, size_);
+  }
+
+ private:
+  // Check the document at "offset" and return it in "doc".
+  Status readAt(size_t offset, ObjectView *doc) const;
+
+  // Scan the file from the end of the index until "n" documents are indexed,
+  // or the end of file is reached.
+  Status extendIndex(size_t n);
+
+ private:
+  bool open_;
+  const char *data_;
+  size_t size_;
+
+  size_t pos_;  // offset of the document that Next reads.
+  Status status_;
+
+  bool indexOnNext_;
+  std::vector<size_t> offsets_;  // offsets of the first documents in order
+  size_t indexEnd_;              // where the document after them begins
+};
+
+}  // namespace bson
@@ -0,0 +1,127 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "BSONFileWriter.h"
+#include "JSONWriter.h"  // FdSink
+
+namespace bson {
+
+Status BSONFileWriter::Open(const std::string &path, const Options &options) {
+  Status s = Close();
+  if (!s)
+    return s;
+
+  int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                  0644);
+  if (fd < 0)
+    return Status::IOError("open " + path + ": " + strerror(errno));
+
+  fd_ = fd;
+  options_ = options;
+  status_ = Status::OK();
+  bytesAppended_ = 0;
+  numWrites_ = 0;
+  unsyncedBytes_ = 0;
+  lastSync_ = std::chrono::steady_clock::now();
+  return Status::OK();
+}
+
+Status BSONFileWriter::Close() {
+  if (fd_ < 0)
+    return Status::OK();
+
+  Status s = options_.sync == kSyncNever ? Flush() : Sync();
+  if (::close(fd_) != 0 && s)
+    s = Status::IOError(std::string("close: ") + strerror(errno));
+  fd_ = -1;
+  buf_.Clear();
+  return s;
+}
+
+Status BSONFileWriter::write(Slice extra) {
+  if (!status_)
+    return status_;
+
+  Slice pieces[2] = {Slice(buf_.Buf(), buf_.Len()), extra};
+  if (pieces[0].Len() + pieces[1].Len() == 0)
+    return status_;
+
+  status_ = FdSink(fd_).Consume(pieces, 2);
+  numWrites_++;
+  buf_.Clear();
+  return status_;
+}
+
+Status BSONFileWriter::Append(const ObjectView &doc) {
+  BOOST_ASSERT_MSG(fd_ >= 0, "BSONFileWriter is not open");
+  if (!status_)
+    return status_;
+
+  size_t size = doc.TotalSize();
+  if (buf_.Len() + size > options_.bufferSize) {
+    if (!write(Slice(doc.RawData(), size)))
+      return status_;
+  } else {
+    buf_.AppendBuf(doc.RawData(), size);
+  }
+  bytesAppended_ += size;
+  unsyncedBytes_ += size;
+
+  switch (options_.sync) {
+    case kSyncEveryDocument:
+      return Sync();
+    case kSyncEveryNBytes:
+      if (unsyncedBytes_ >= options_.syncBytes)
+        return Sync();
+      break;
+    case kSyncPeriodically:
+      if (std::chrono::steady_clock::now() - lastSync_ >=
+          options_.syncInterval)
+        return Sync();
+      break;
+    default:
+      break;
+  }
+  return status_;
+}
+
+Status BSONFileWriter::Flush() {
+  return write(Slice());
+}
+
+Status BSONFileWriter::Sync() {
+  if (!Flush())
+    return status_;
+
+  while (::fsync(fd_) != 0) {
+    if (errno != EINTR) {
+      status_ = Status::IOError(std::string("fsync: ") + strerror(errno));
+      return status_;
+    }
+  }
+  unsyncedBytes_ = 0;
+  lastSync_ = std::chrono::steady_clock::now();
+  return status_;
+}
+
+}  // namespace bson
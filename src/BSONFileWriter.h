@@ -0,0 +1,137 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include "BufBuilder.h"
+#include "DisallowCopying.h"
+#include "Object.h"
+#include "Status.h"
+
+namespace bson {
+
+// BSONFileWriter appends BSON objects to a file, producing the format
+// BSONFileReader reads.
+//
+// Objects are copied into a buffer and written out together once it's full,
+// so that many small objects cost a single writev(2). An object that doesn't
+// fit in the buffer is written along with the buffered ones in the same
+// writev, without being copied.
+//
+// The sync policy decides when the written data is fsync'ed to disk:
+//
+// - kSyncNever: leaves it to the OS, Flush only hands the data to the
+//   kernel.
+// - kSyncEveryDocument: every Append is written and fsync'ed before it
+//   returns.
+// - kSyncEveryNBytes: fsync once "syncBytes" bytes are appended since the
+//   last one.
+// - kSyncPeriodically: fsync on the first Append that comes at least
+//   "syncInterval" after the last one. There's no background thread, an idle
+//   writer doesn't sync until the next Append, Sync or Close.
+//
+// Write errors are sticky: once a write fails, all later calls return the
+// same error.
+//
+class BSONFileWriter {
+  __DISALLOW_COPYING__(BSONFileWriter);
+
+ public:
+  enum SyncPolicy_t {
+    kSyncNever = 0,
+    kSyncEveryDocument = 1,
+    kSyncEveryNBytes = 2,
+    kSyncPeriodically = 3
+  };
+
+  enum { kDefaultBufferSize = 256 * 1024 };
+
+  struct Options {
+    size_t bufferSize;
+    SyncPolicy_t sync;
+    size_t syncBytes;                        // kSyncEveryNBytes
+    std::chrono::milliseconds syncInterval;  // kSyncPeriodically
+
+    Options()
+        : bufferSize(kDefaultBufferSize),
+          sync(kSyncNever),
+          syncBytes(4 * 1024 * 1024),
+          syncInterval(1000) {}
+  };
+
+  BSONFileWriter()
+      : fd_(-1),
+        buf_(0),
+        bytesAppended_(0),
+        numWrites_(0),
+        unsyncedBytes_(0) {}
+
+  // Pending data is flushed, errors are ignored. Call Close to get them.
+  ~BSONFileWriter() {
+    Close();
+  }
+
+  // Open "path" for appending, creating it if it doesn't exist.
+  Status Open(const std::string &path, const Options &options = Options());
+
+  // Flush the buffer, fsync if the policy asks for it, and close the file.
+  Status Close();
+
+  bool IsOpen() const {
+    return fd_ >= 0;
+  }
+
+  Status Append(const ObjectView &doc);
+
+  // Write the buffered objects to the file.
+  Status Flush();
+
+  // Flush and fsync.
+  Status Sync();
+
+  // @return the number of bytes appended, including the buffered ones.
+  size_t BytesAppended() const {
+    return bytesAppended_;
+  }
+
+  // @return the number of times the file was written.
+  size_t NumWrites() const {
+    return numWrites_;
+  }
+
+ private:
+  // Write the buffer followed by "extra" out.
+  Status write(Slice extra);
+
+ private:
+  int fd_;
+  Options options_;
+  Status status_;
+
+  BufBuilder buf_;
+  size_t bytesAppended_;
+  size_t numWrites_;
+
+  size_t unsyncedBytes_;
+  std::chrono::steady_clock::time_point lastSync_;
+};
+
+}  // namespace bson
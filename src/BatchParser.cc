@@ -0,0 +1,200 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include "BatchParser.h"
+#include "Parser.h"
+
+namespace bson {
+
+namespace {
+
+// A record parsed into the current batch, but not yet delivered.
+struct PendingRecord {
+  size_t offset;     // where the record begins in the input
+  size_t docOffset;  // where the document begins in the batch
+  Status status;
+};
+
+// Chunks of ParseParallel are no smaller than this, and there're about 8 of
+// them per thread otherwise, so that threads which finish early have more
+// chunks to take.
+const size_t kMinChunkSize = 64 * 1024;
+const size_t kChunksPerThread = 8;
+
+}  // namespace
+
+size_t BatchParser::Parse(Slice input, const RecordCallback &callback) {
+  const char *const begin = input.RawData();
+  const char *const end = begin + input.Len();
+
+  ObjectBuilder batch;
+  std::vector<PendingRecord> pending;
+  size_t records = 0;
+
+  // Finish the batch and deliver its records.
+  auto flush = [&]() {
+    Object whole = batch.Done();
+    const SharedBuffer &sbuf = whole.ShareFromThis();
+    for (const PendingRecord &r : pending) {
+      if (r.status) {
+        // The record shares the ownership of the batch.
+        Object obj(SharedBuffer(sbuf, sbuf.get() + r.docOffset));
+        callback(r.offset, r.status, &obj);
+      } else {
+        callback(r.offset, r.status, nullptr);
+      }
+    }
+    pending.clear();
+    // The next batch is allocated as large as this one right away.
+    batch.Reset();
+  };
+
+  const char *p = begin;
+  while ((p = internal::SkipWhitespace(p, end)) != end) {
+    // Each record is embedded in the batch with an empty field name, right
+    // after its type byte and the null terminator of the name.
+    size_t start = batch.Len();
+    Parser parser(Slice(p, static_cast<size_t>(end - p)));
+    Status s = parser.ParseEmbedded("", batch);
+
+    PendingRecord r;
+    r.offset = static_cast<size_t>(p - begin);
+    r.docOffset = start + 2;
+    if (s) {
+      p += parser.Consumed();
+    } else {
+      // Resynchronize at the next line.
+      batch.Truncate(start);
+      r.status = s;
+      const void *nl = memchr(p, '\n', static_cast<size_t>(end - p));
+      p = nl ? static_cast<const char *>(nl) + 1 : end;
+    }
+    pending.push_back(std::move(r));
+    records++;
+
+    if (batch.Len() >= batchSize_)
+      flush();
+  }
+
+  if (!pending.empty())
+    flush();
+  return records;
+}
+
+std::vector<Object> BatchParser::Parse(Slice input,
+                                       std::vector<RecordError> *errors) {
+  std::vector<Object> objects;
+  size_t record = 0;
+  Parse(input, [&](size_t offset, const Status &status, const Object *obj) {
+    if (obj) {
+      objects.push_back(*obj);
+    } else if (errors) {
+      errors->push_back(RecordError{record, offset, status});
+    }
+    record++;
+  });
+  return objects;
+}
+
+std::vector<Object> BatchParser::ParseParallel(
+    Slice input, int threads, std::vector<RecordError> *errors) {
+  if (threads <= 1)
+    return Parse(input, errors);
+
+  const char *const begin = input.RawData();
+  const char *const end = begin + input.Len();
+
+  // Split the input right after the first newline following each multiple of
+  // the chunk size.
+  size_t nchunks = static_cast<size_t>(threads) * kChunksPerThread;
+  size_t chunkSize = std::max(kMinChunkSize, input.Len() / nchunks);
+  std::vector<Slice> chunks;
+  for (const char *p = begin; p < end;) {
+    const char *q = p + std::min(chunkSize, static_cast<size_t>(end - p));
+    if (q < end) {
+      const void *nl = memchr(q, '\n', static_cast<size_t>(end - q));
+      q = nl ? static_cast<const char *>(nl) + 1 : end;
+    }
+    chunks.push_back(Slice(p, static_cast<size_t>(q - p)));
+    p = q;
+  }
+  if (chunks.empty())
+    return std::vector<Object>();
+
+  struct ChunkResult {
+    std::vector<Object> objects;
+    std::vector<RecordError> errors;  // indexed by record within the chunk
+    size_t records;
+  };
+  std::vector<ChunkResult> results(chunks.size());
+  std::atomic<size_t> next(0);
+
+  auto worker = [&]() {
+    for (size_t i; (i = next.fetch_add(1)) < chunks.size();) {
+      ChunkResult &r = results[i];
+      size_t base = static_cast<size_t>(chunks[i].RawData() - begin);
+      size_t record = 0;
+      r.records = Parse(chunks[i], [&](size_t offset, const Status &status,
+                                       const Object *obj) {
+        if (obj) {
+          r.objects.push_back(*obj);
+        } else if (errors) {
+          r.errors.push_back(RecordError{record, base + offset, status});
+        }
+        record++;
+      });
+    }
+  };
+
+  // The calling thread is one of the workers.
+  std::vector<std::thread> pool;
+  size_t helpers = std::min(static_cast<size_t>(threads), chunks.size()) - 1;
+  for (size_t i = 0; i < helpers; i++)
+    pool.emplace_back(worker);
+  worker();
+  for (std::thread &t : pool)
+    t.join();
+
+  // Merge in input order.
+  size_t total = 0;
+  for (const ChunkResult &r : results)
+    total += r.objects.size();
+
+  std::vector<Object> objects;
+  objects.reserve(total);
+  size_t records = 0;
+  for (ChunkResult &r : results) {
+    objects.insert(objects.end(), r.objects.begin(), r.objects.end());
+    if (errors) {
+      for (RecordError &e : r.errors) {
+        e.record += records;
+        errors->push_back(std::move(e));
+      }
+    }
+    records += r.records;
+  }
+  return objects;
+}
+
+}  // namespace bson
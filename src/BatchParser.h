@@ -0,0 +1,89 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "DisallowCopying.h"
+#include "Object.h"
+#include "Status.h"
+
+namespace bson {
+
+// BatchParser parses a large buffer of json records, e.g. an mmapped
+// newline-delimited json (NDJSON) file, or json documents simply
+// concatenated with optional whitespaces in between. Records are parsed with
+// the recursive-descent Parser, so the extended syntax is accepted as well.
+//
+// With ParseParallel, the records of newline-delimited json are parsed on
+// multiple threads.
+//
+// A record that fails to parse doesn't abort the batch: its error is
+// reported, and parsing resumes at the line following the beginning of the
+// bad record.
+//
+// Instead of allocating a buffer for each record, the records are built one
+// after another into the shared buffer of a batch of about "batchSize"
+// bytes. The objects of the same batch share ownership of its buffer, which
+// is freed once all of them are gone.
+//
+class BatchParser {
+  __DISALLOW_COPYING__(BatchParser);
+
+ public:
+  enum { kDefaultBatchSize = 1024 * 1024 };
+
+  // Called for every record in order. "obj" is the parsed record if "status"
+  // is OK, and nullptr otherwise.
+  // @param offset where the record begins in the input.
+  typedef std::function<void(size_t offset, const Status &status,
+                             const Object *obj)> RecordCallback;
+
+  struct RecordError {
+    size_t record;  // index of the record in the batch
+    size_t offset;  // where the record begins in the input
+    Status status;
+  };
+
+  explicit BatchParser(size_t batchSize = kDefaultBatchSize)
+      : batchSize_(batchSize) {}
+
+  // Parse all records in "input". The callback is invoked once the batch
+  // holding the record is finished, so the records are delivered in batches
+  // of about "batchSize" bytes.
+  // @return the number of records.
+  size_t Parse(Slice input, const RecordCallback &callback);
+
+  // @return the records that were successfully parsed, in order. The errors
+  // of the other records are appended to "errors" if it's not nullptr.
+  std::vector<Object> Parse(Slice input,
+                            std::vector<RecordError> *errors = nullptr);
+
+  // Like Parse above, but the input is split at line boundaries into chunks,
+  // which are parsed by "threads" threads in parallel, each taking the next
+  // unparsed chunk as soon as it's done with one. Every record must be on a
+  // single line. The records are returned in input order.
+  std::vector<Object> ParseParallel(Slice input, int threads,
+                                    std::vector<RecordError> *errors = nullptr);
+
+ private:
+  const size_t batchSize_;
+};
+
+}  // namespace bson
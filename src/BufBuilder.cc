@@ -25,10 +25,33 @@
 namespace bson {
 
 void BufBuilder::kill() {
-  if (buf_) {
-    std::free(buf_);
-    buf_ = nullptr;
+  if (buf_ != inline_) {
+    if (alloc_)
+      alloc_->Deallocate(buf_);
+    else
+      std::free(buf_);
   }
+  buf_ = nullptr;
+}
+
+char *BufBuilder::allocate(size_t size) {
+  char *p = alloc_ ? static_cast<char *>(alloc_->Allocate(size))
+                   : static_cast<char *>(std::malloc(size));
+  BOOST_ASSERT_MSG(p != nullptr, "out of memory in BufBuilder::allocate");
+  return p;
+}
+
+const char *BufBuilder::Release() {
+  char *r = buf_;
+  if (r == inline_) {
+    r = allocate(len_);
+    memcpy(r, inline_, len_);
+  }
+  buf_ = inline_;
+  cap_ = kInlineSize;
+  len_ = 0;
+  reservedBytes_ = 0;
+  return r;
 }
 
 void BufBuilder::ensureCapacity(size_t n) {
@@ -40,7 +63,14 @@ void BufBuilder::ensureCapacity(size_t n) {
     size_t newcap = (oldcap * 3) / 2 + 1;
     if (newcap < minsize)
       newcap = minsize;
-    buf_ = (char *)std::realloc(buf_, newcap);
+    if (buf_ == inline_) {
+      buf_ = allocate(newcap);
+      memcpy(buf_, inline_, len_);
+    } else if (alloc_) {
+      buf_ = static_cast<char *>(alloc_->Reallocate(buf_, len_, newcap));
+    } else {
+      buf_ = (char *)std::realloc(buf_, newcap);
+    }
     BOOST_ASSERT_MSG(buf_ != nullptr,
                      "out of memory BufBuilder::ensureCapacity");
     cap_ = newcap;
@@ -21,6 +21,7 @@
 #include <type_traits>
 #include <boost/assert.hpp>
 
+#include "Allocator.h"
 #include "DataView.h"
 #include "Slice.h"
 #include "DisallowCopying.h"
@@ -35,12 +36,22 @@ class BufBuilder {
   __DISALLOW_COPYING__(BufBuilder);
 
  public:
-  BufBuilder(size_t init_size = 512)
-      : cap_(init_size), len_(0), buf_(nullptr), reservedBytes_(0) {
-    if (init_size) {
-      buf_ = (char*)malloc(init_size);
-      BOOST_ASSERT_MSG(buf_ != nullptr,
-                       "out of memory in BufBuilder::BufBuilder");
+  // Buffers of up to this size are held by the BufBuilder itself, and only
+  // moved to the heap (or to the allocator) once they outgrow it.
+  enum { kInlineSize = 256 };
+
+  // @param init_size the initial capacity.
+  // @param alloc where the buffer is allocated from, malloc is used if it's
+  // nullptr. The allocator must outlive the buffer.
+  BufBuilder(size_t init_size = kInlineSize, Allocator* alloc = nullptr)
+      : buf_(inline_),
+        cap_(kInlineSize),
+        len_(0),
+        reservedBytes_(0),
+        alloc_(alloc) {
+    if (init_size > kInlineSize) {
+      buf_ = allocate(init_size);
+      cap_ = init_size;
     }
   }
 
@@ -99,11 +110,22 @@ class BufBuilder {
     reservedBytes_ = 0;
   }
 
-  // Release the ownership of the buffer.
-  const char* Release() {
-    char* r = buf_;
-    buf_ = nullptr;
-    return r;
+  // Drop the bytes after the first "len" ones.
+  void Truncate(size_t len) {
+    BOOST_ASSERT(len <= len_);
+    len_ = len;
+  }
+
+  // Release the ownership of the buffer, which is to be freed with free(), or
+  // by the allocator of this BufBuilder if any. An inline buffer is copied to
+  // a block just large enough for its content.
+  //
+  // The builder is left empty, with its inline buffer.
+  const char* Release();
+
+  // Make room for "n" more bytes, so that appending them doesn't reallocate.
+  void Reserve(size_t n) {
+    ensureCapacity(n);
   }
 
  public:
@@ -123,6 +145,11 @@ class BufBuilder {
     return len_;
   }
 
+  // @return whether the content is still in the inline buffer.
+  bool IsInline() const {
+    return buf_ == inline_;
+  }
+
   //  size_t Reserved() const {
   //    return reservedBytes_;
   //  }
@@ -136,11 +163,45 @@ class BufBuilder {
   // @param size is the number of bytes needed.
   void ensureCapacity(size_t size);
 
+  // Allocate a block of "size" bytes from the allocator, or malloc.
+  char* allocate(size_t size);
+
  private:
   char* buf_;
   size_t cap_;
   size_t len_;
   size_t reservedBytes_;
+  Allocator* alloc_;
+  char inline_[kInlineSize];
+};
+
+// SizeHint learns the typical size of the buffers built at some call site, so
+// that the next ones are allocated large enough up front:
+//
+//   static thread_local SizeHint hint;
+//   ObjectBuilder builder(&hint);
+//
+// It follows the largest of the recent sizes, and decays slowly towards
+// smaller ones, so that a single large outlier doesn't stick.
+//
+// SizeHint is not thread-safe.
+class SizeHint {
+ public:
+  SizeHint() : size_(0) {}
+
+  size_t Get() const {
+    return size_;
+  }
+
+  void Update(size_t size) {
+    if (size >= size_)
+      size_ = size;
+    else
+      size_ -= (size_ - size) / 8;
+  }
+
+ private:
+  size_t size_;
 };
 
 }  // namespace bson
\ No newline at end of file
@@ -21,36 +21,24 @@
 #include "Element.h"
 #include "Slice.h"
 #include "UnixTimestamp.h"
+#include "ValueTypes.h"
 
 namespace bson {
 
 size_t Element::Size() const {
-  size_t valueSize = 0;
-  Type_t t = Type();
-  switch (t) {
-    case kEOO:
-    case kNull:
-      break;
-    case kBoolean:
-      valueSize = 1;
-      break;
-    case kNumberInt:
-      valueSize = 4;
-      break;
-    case kNumberDouble:
-    case kNumberLong:
-    case kDatetime:
-      valueSize = 8;
-      break;
-    case kString:
-      valueSize = ValueStrSize() + SZ_ValueStrSize;
-      break;
-    case kObject:
-    case kArray:
-      valueSize = ValueObjSize();
-      break;
-    default:
-      BOOST_ASSERT(IsValidType(t));
+  if (totalSize_)
+    return totalSize_;
+
+  const TypeInfo &info = GetTypeInfo(Type());
+  size_t valueSize = info.size;
+  if (info.sizing == kPrefixedValue) {
+    valueSize += static_cast<size_t>(ConstDataView(RawValue()).ReadNum<int>());
+  } else if (info.sizing == kRegexValue) {
+    const char *pattern = RawValue();
+    size_t patternSize = strlen(pattern) + 1;
+    valueSize = patternSize + strlen(pattern + patternSize) + 1;
+  } else {
+    BOOST_ASSERT(info.sizing == kFixedValue);
   }
   totalSize_ = SZ_Type + valueSize + FieldNameSize();
   return totalSize_;
@@ -94,6 +82,90 @@ template <> UnixTimestamp Element::ValueOf<UnixTimestamp>() const {
   return *reinterpret_cast<const UnixTimestamp *>(RawValue());
 }
 
+template <> ObjectId Element::ValueOf<ObjectId>() const {
+  checkType(kObjectId);
+  ObjectId oid;
+  memcpy(oid.bytes, RawValue(), sizeof(oid.bytes));
+  return oid;
+}
+
+template <> BinData Element::ValueOf<BinData>() const {
+  checkType(kBinData);
+  const char *v = RawValue();
+  BinData bin;
+  bin.subtype = static_cast<unsigned char>(v[4]);
+  bin.data = Slice(v + 5, ConstDataView(v).ReadNum<int>());
+  return bin;
+}
+
+template <> Timestamp Element::ValueOf<Timestamp>() const {
+  checkType(kTimestamp);
+  Timestamp ts;
+  ts.increment = ConstDataView(RawValue()).ReadNum<uint32_t>();
+  ts.seconds = ConstDataView(RawValue() + 4).ReadNum<uint32_t>();
+  return ts;
+}
+
+template <> Decimal128 Element::ValueOf<Decimal128>() const {
+  checkType(kNumberDecimal);
+  Decimal128 d;
+  d.low = ConstDataView(RawValue()).ReadNum<uint64_t>();
+  d.high = ConstDataView(RawValue() + 8).ReadNum<uint64_t>();
+  return d;
+}
+
+template <> Regex Element::ValueOf<Regex>() const {
+  checkType(kRegex);
+  Regex re;
+  re.pattern = Slice(RawValue());
+  re.options = Slice(RawValue() + re.pattern.Len() + 1);
+  return re;
+}
+
+// A string value: int32 size including the terminating null, then the string.
+static Slice readString(const char *v) {
+  return Slice(v + sizeof(int), ConstDataView(v).ReadNum<int>() - 1);
+}
+
+template <> Code Element::ValueOf<Code>() const {
+  checkType(kCode);
+  Code code;
+  code.code = readString(RawValue());
+  return code;
+}
+
+template <> Symbol Element::ValueOf<Symbol>() const {
+  checkType(kSymbol);
+  Symbol sym;
+  sym.symbol = readString(RawValue());
+  return sym;
+}
+
+template <> CodeWScope Element::ValueOf<CodeWScope>() const {
+  checkType(kCodeWScope);
+  CodeWScope cws;
+  const char *v = RawValue() + sizeof(int);
+  cws.code = readString(v);
+  cws.scope = ObjectView(v + sizeof(int) + cws.code.Len() + 1);
+  return cws;
+}
+
+template <> DBPointer Element::ValueOf<DBPointer>() const {
+  checkType(kDBPointer);
+  DBPointer ptr;
+  ptr.ns = readString(RawValue());
+  memcpy(ptr.id.bytes, RawValue() + sizeof(int) + ptr.ns.Len() + 1,
+         sizeof(ptr.id.bytes));
+  return ptr;
+}
+
+template <> ObjectView Element::ValueOf<ObjectView>() const {
+  DCHECK(Type() == kObject || Type() == kArray)
+      << "unexpected or missing of type value in BSON object: "
+      << TypeToString(Type());
+  return ObjectView(RawValue());
+}
+
 // template <> const char* Element::ValueOf<const char *>() const {
 //  checkType(kString);
 //  return (RawValue()+ sizeof(int));
@@ -23,9 +23,25 @@
 
 #include "Type.h"
 #include "DataView.h"
+#include "Slice.h"
+#include "UnixTimestamp.h"
 
 namespace bson {
 
+// @see ValueTypes.h
+struct ObjectId;
+struct BinData;
+struct Timestamp;
+struct Decimal128;
+struct Regex;
+struct Code;
+struct Symbol;
+struct CodeWScope;
+struct DBPointer;
+
+// @see Object.h
+class ObjectView;
+
 //  Element represents an "element" in a Object.  So for the object
 //  { a : 3, b : "abc" }, 'a : 3' is the first element (key+value).
 //
@@ -43,6 +59,10 @@ class Element {
   explicit Element(const char *data)
       : fieldNameSize_(-1), elem_(data), totalSize_(0) {}
 
+  // An EOO element, which stands for a missing field in lookups that return
+  // elements by value.
+  Element() : Element("\0") {}
+
  public:
   //
   // Observers
@@ -115,4 +135,26 @@ class Element {
   mutable size_t totalSize_;
 };
 
+// Specializations of Element::ValueOf, defined in Element.cc.
+template <> int Element::ValueOf<int>() const;
+template <> long long Element::ValueOf<long long>() const;
+template <> double Element::ValueOf<double>() const;
+template <> bool Element::ValueOf<bool>() const;
+template <> Slice Element::ValueOf<Slice>() const;
+template <> UnixTimestamp Element::ValueOf<UnixTimestamp>() const;
+template <> ObjectId Element::ValueOf<ObjectId>() const;
+template <> BinData Element::ValueOf<BinData>() const;
+template <> Timestamp Element::ValueOf<Timestamp>() const;
+template <> Decimal128 Element::ValueOf<Decimal128>() const;
+template <> Regex Element::ValueOf<Regex>() const;
+template <> Code Element::ValueOf<Code>() const;
+template <> Symbol Element::ValueOf<Symbol>() const;
+template <> CodeWScope Element::ValueOf<CodeWScope>() const;
+template <> DBPointer Element::ValueOf<DBPointer>() const;
+
+// Embedded objects and arrays are viewed in place, without copying. The view
+// is only valid as long as the bytes of the outer object, @see
+// Object::Embedded for an Object sharing the ownership of them.
+template <> ObjectView Element::ValueOf<ObjectView>() const;
+
 }  // namespace bson
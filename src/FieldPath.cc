@@ -0,0 +1,149 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <utility>
+
+#include "FieldPath.h"
+
+namespace bson {
+
+static const size_t kTotalSize = 4;
+
+FieldPath::FieldPath(Slice path)
+    : path_(path.RawData(), path.Len()), names_(path_) {
+  size_t begin = 0;
+  for (size_t i = 0; i <= names_.size(); i++) {
+    if (i < names_.size() && names_[i] != '.')
+      continue;
+
+    Component c;
+    c.name = static_cast<uint32_t>(begin);
+    c.index = -1;
+
+    // Indexes are limited to 18 digits, which can't overflow.
+    size_t len = i - begin;
+    if (len > 0 && len <= 18) {
+      int64_t index = 0;
+      size_t j = begin;
+      for (; j < i && names_[j] >= '0' && names_[j] <= '9'; j++)
+        index = index * 10 + (names_[j] - '0');
+      if (j == i)
+        c.index = index;
+    }
+
+    components_.push_back(c);
+    if (i < names_.size())
+      names_[i] = '\0';
+    begin = i + 1;
+  }
+}
+
+bool FieldPath::Extract(const ObjectView &obj, Element *result) const {
+  const char *doc = obj.RawData();
+  bool inArray = false;
+
+  for (size_t depth = 0; depth < components_.size(); depth++) {
+    const Component &c = components_[depth];
+    if (inArray && c.index < 0)
+      return false;
+
+    const char *p = doc + kTotalSize;
+    int64_t pos = 0;
+    while (*p != kEOO) {
+      Element e(p);
+      if (matches(c, e.RawFieldName(), pos, inArray))
+        break;
+      p += e.Size();
+      pos++;
+    }
+    if (*p == kEOO)
+      return false;
+
+    Element e(p);
+    if (depth + 1 == components_.size()) {
+      *result = e;
+      return true;
+    }
+    if (e.Type() != kObject && e.Type() != kArray)
+      return false;
+    doc = e.RawValue();
+    inArray = e.Type() == kArray;
+  }
+  return false;
+}
+
+// "active" holds the indexes of the paths that continue in "doc", whose
+// component at "depth" is yet to be matched. It's reordered in place, the
+// paths matching the same element are moved to the front and passed down
+// together.
+void FieldPath::extract(const char *doc, bool inArray, size_t depth,
+                        const FieldPath *paths, size_t *active, size_t n,
+                        Element *results, size_t *found) {
+  const char *p = doc + kTotalSize;
+  for (int64_t pos = 0; n > 0 && *p != kEOO; pos++) {
+    Element e(p);
+    const char *fieldName = e.RawFieldName();
+    bool isDoc = e.Type() == kObject || e.Type() == kArray;
+
+    // Move the paths going through this element to the front, the ones that
+    // continue in it first.
+    size_t matched = 0, down = 0;
+    for (size_t i = 0; i < n; i++) {
+      const FieldPath &path = paths[active[i]];
+      if (!path.matches(path.components_[depth], fieldName, pos, inArray))
+        continue;
+
+      std::swap(active[i], active[matched]);
+      if (depth + 1 == path.components_.size()) {
+        results[active[matched]] = e;
+        (*found)++;
+      } else if (isDoc) {
+        std::swap(active[matched], active[down]);
+        down++;
+      }
+      matched++;
+    }
+
+    if (down > 0) {
+      extract(e.RawValue(), e.Type() == kArray, depth + 1, paths, active,
+              down, results, found);
+    }
+
+    // The paths matched here are done with this document.
+    active += matched;
+    n -= matched;
+    p += e.Size();
+  }
+}
+
+size_t FieldPath::Extract(const ObjectView &obj, const FieldPath *paths,
+                          size_t n, Element *results) {
+  std::vector<size_t> active;
+  active.reserve(n);
+  for (size_t i = 0; i < n; i++) {
+    results[i] = Element();
+    active.push_back(i);
+  }
+
+  size_t found = 0;
+  extract(obj.RawData(), false, 0, paths, active.data(), active.size(),
+          results, &found);
+  return found;
+}
+
+}  // namespace bson
@@ -0,0 +1,94 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Element.h"
+#include "Object.h"
+#include "Slice.h"
+
+namespace bson {
+
+// FieldPath is a dotted path to a field nested in embedded objects and
+// arrays, e.g "friends.3.name" is the "name" field of the 4th element of the
+// "friends" array.
+//
+// The path is parsed once, so that extracting it from many objects costs
+// nothing but the walk over their bytes: no Object or SharedBuffer is made
+// for the embedded documents along the way.
+//
+// A component made of digits only is an array index when it's applied to an
+// array, and a field name otherwise. Array elements are matched by their
+// position, whatever their field names are.
+//
+class FieldPath {
+ public:
+  explicit FieldPath(Slice path);
+
+  // intentionally copyable
+
+  // @return the path as it was given.
+  const std::string &ToString() const {
+    return path_;
+  }
+
+  size_t NumComponents() const {
+    return components_.size();
+  }
+
+  // Find the element at this path in "obj". The first matching field is
+  // taken at each level, as find does.
+  // @return false if there's no such element, "result" is left untouched.
+  bool Extract(const ObjectView &obj, Element *result) const;
+
+  // Extract "n" paths from "obj" at once, walking each embedded document at
+  // most once no matter how many of the paths go through it. The element at
+  // "paths[i]" is stored into "results[i]", or an EOO element if there's no
+  // such element.
+  // @return the number of paths that were found.
+  static size_t Extract(const ObjectView &obj, const FieldPath *paths,
+                        size_t n, Element *results);
+
+ private:
+  struct Component {
+    uint32_t name;   // offset of the '\0'-terminated name in names_
+    int64_t index;   // array index, or -1 if the name is not a number
+  };
+
+  bool matches(const Component &c, const char *fieldName, int64_t pos,
+               bool inArray) const {
+    if (inArray)
+      return c.index == pos;
+    return strcmp(names_.data() + c.name, fieldName) == 0;
+  }
+
+  static void extract(const char *doc, bool inArray, size_t depth,
+                      const FieldPath *paths, size_t *active, size_t n,
+                      Element *results, size_t *found);
+
+ private:
+  std::string path_;
+  std::string names_;  // the path with every '.' replaced by '\0'
+  std::vector<Component> components_;
+};
+
+}  // namespace bson
@@ -0,0 +1,322 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+#include "IncrementalParser.h"
+#include "internal/NumberParser.h"
+#include "internal/Scanner.h"
+
+namespace bson {
+
+namespace {
+
+inline bool tokenEquals(Slice token, const char *literal) {
+  size_t len = strlen(literal);
+  return token.Len() == len && memcmp(token.RawData(), literal, len) == 0;
+}
+
+// Numbers and literals last until a whitespace or a structural character.
+inline const char *findTokenEnd(const char *p, const char *end) {
+  while (p < end && !internal::IsSpace(*p) && !strchr("{}[]:,\"", *p))
+    p++;
+  return p;
+}
+
+}  // namespace
+
+void IncrementalParser::Reset() {
+  state_ = kRoot;
+  status_ = Status::OK();
+  builder_.reset();
+  scopes_.clear();
+  keys_.clear();
+  field_.clear();
+  token_.clear();
+  escape_.clear();
+  consumed_ = 0;
+  chunk_ = nullptr;
+  chunkLen_ = 0;
+}
+
+Status IncrementalParser::Feed(Slice chunk, std::vector<Object> *objects) {
+  if (!status_)
+    return status_;
+
+  const char *p = chunk.RawData();
+  const char *end = p + chunk.Len();
+  consumed_ += chunkLen_;
+  chunk_ = p;
+  chunkLen_ = chunk.Len();
+
+  while (true) {
+    // Tokens that were cut by the end of the previous chunk.
+    if (state_ == kInField || state_ == kInString) {
+      p = continueString(p, end);
+      if (p == nullptr)
+        return status_;
+      continue;
+    }
+
+    if (state_ == kInToken) {
+      const char *t = findTokenEnd(p, end);
+      token_.append(p, static_cast<size_t>(t - p));
+      if (t == end)
+        return Status::OK();
+
+      Status s = finishScalar(token_, t);
+      if (!s)
+        return s;
+      token_.clear();
+      p = t;
+      state_ = kCommaOrClose;
+      continue;
+    }
+
+    p = internal::SkipWhitespace(p, end);
+    if (p == end)
+      return Status::OK();
+
+    bool isArray = !scopes_.empty() && scopes_.back();
+    char close = isArray ? ']' : '}';
+
+    switch (state_) {
+      case kRoot:
+        if (*p != '{' && *p != '[')
+          return fail("Expecting { or [", p);
+        builder_.reset(new ObjectBuilder);
+        pushScope(*p == '[');
+        state_ = kFirstOrClose;
+        p++;
+        break;
+
+      case kFirstOrClose:
+        if (*p == close) {
+          p++;
+          closeScope(objects);
+        } else {
+          state_ = isArray ? kValue : kField;
+        }
+        break;
+
+      case kField:
+        if (*p != '"')
+          return fail("Expecting field name", p);
+        field_.clear();
+        state_ = kInField;
+        p++;
+        break;
+
+      case kColon:
+        if (*p != ':')
+          return fail("Expecting :", p);
+        state_ = kValue;
+        p++;
+        break;
+
+      case kValue:
+        if (*p == '{' || *p == '[') {
+          if (*p == '{') {
+            builder_->BeginSubObject(field());
+          } else {
+            builder_->BeginSubArray(field());
+          }
+          pushScope(*p == '[');
+          state_ = kFirstOrClose;
+          p++;
+        } else if (strchr("}]:,", *p)) {
+          return fail("Expecting value", p);
+        } else {
+          p = beginValue(p, end);
+          if (!status_)
+            return status_;
+        }
+        break;
+
+      case kCommaOrClose:
+        if (*p == ',') {
+          state_ = isArray ? kValue : kField;
+        } else if (*p == close) {
+          closeScope(objects);
+        } else {
+          return fail(isArray ? "Expecting ] or ," : "Expecting } or ,", p);
+        }
+        p++;
+        break;
+
+      default:
+        BOOST_ASSERT_MSG(0, "Unexpected state of IncrementalParser.");
+    }
+  }
+}
+
+Status IncrementalParser::Finish() {
+  if (!status_)
+    return status_;
+  if (state_ != kRoot)
+    return fail("Unexpected end of input", chunk_ + chunkLen_);
+  return Status::OK();
+}
+
+const char *IncrementalParser::continueString(const char *p,
+                                              const char *end) {
+  bool isField = (state_ == kInField);
+  auto append = [this, isField](Slice piece) {
+    if (isField) {
+      field_.append(piece.RawData(), piece.Len());
+    } else {
+      builder_->AppendStrPiece(piece);
+    }
+  };
+
+  // Complete the escape sequence cut by the end of the previous chunk with
+  // the beginning of this one, and decode them together.
+  const char *q = nullptr, *stop = p;
+  while (!escape_.empty() && stop != nullptr) {
+    if (p == end)
+      return nullptr;
+    size_t prev = escape_.size();
+    size_t n = std::min(static_cast<size_t>(end - p),
+                        static_cast<size_t>(internal::kMaxEscapeSize));
+    escape_.append(p, n);
+    const char *b = escape_.data(), *e = b + escape_.size();
+    q = internal::DecodeQuotedPrefix(b, e, '"', append, &stop);
+    if (q != nullptr) {
+      q = p + (q - b - prev);
+      escape_.clear();
+    } else if (stop != nullptr) {
+      escape_.erase(0, static_cast<size_t>(stop - b));
+      p += n;
+    }
+  }
+
+  if (q == nullptr && stop != nullptr) {
+    q = internal::DecodeQuotedPrefix(p, end, '"', append, &stop);
+    if (q == nullptr && stop != nullptr) {
+      escape_.assign(stop, static_cast<size_t>(end - stop));
+      return nullptr;
+    }
+  }
+
+  if (q == nullptr) {
+    fail("Malformed \\u escape", p);
+    return nullptr;
+  }
+
+  if (isField) {
+    state_ = kColon;
+  } else {
+    builder_->EndStr();
+    state_ = kCommaOrClose;
+  }
+  return q;
+}
+
+const char *IncrementalParser::beginValue(const char *p, const char *end) {
+  if (*p == '"') {
+    builder_->BeginStr(field());
+    state_ = kInString;
+    return p + 1;
+  }
+
+  // Numbers and literals are parsed in place unless they're cut by the end
+  // of the chunk.
+  const char *t = findTokenEnd(p, end);
+  if (t == end) {
+    token_.assign(p, static_cast<size_t>(t - p));
+    state_ = kInToken;
+    return t;
+  }
+
+  if (finishScalar(Slice(p, static_cast<size_t>(t - p)), p))
+    state_ = kCommaOrClose;
+  return t;
+}
+
+Status IncrementalParser::finishScalar(Slice token, const char *p) {
+  Slice f = field();
+  if (tokenEquals(token, "true")) {
+    builder_->AppendBool(f, true);
+  } else if (tokenEquals(token, "false")) {
+    builder_->AppendBool(f, false);
+  } else if (tokenEquals(token, "null")) {
+    builder_->AppendNull(f);
+  } else if (tokenEquals(token, "Infinity")) {
+    builder_->AppendDouble(f, std::numeric_limits<double>::infinity());
+  } else if (tokenEquals(token, "-Infinity")) {
+    builder_->AppendDouble(f, -std::numeric_limits<double>::infinity());
+  } else if (tokenEquals(token, "NaN")) {
+    builder_->AppendDouble(f, std::numeric_limits<double>::quiet_NaN());
+  } else {
+    internal::NumberValue num;
+    const char *end = token.RawData() + token.Len();
+    if (internal::ParseNumber(token.RawData(), end, &num) != end)
+      return fail("Invalid conversion from string to number", p);
+
+    switch (num.type) {
+      case kNumberInt:
+        builder_->AppendInt(f, num.intVal);
+        break;
+      case kNumberLong:
+        builder_->AppendLong(f, num.longVal);
+        break;
+      default:
+        if (std::isinf(num.doubleVal))
+          return fail("Value cannot fit in double", p);
+        builder_->AppendDouble(f, num.doubleVal);
+        break;
+    }
+  }
+  return Status::OK();
+}
+
+void IncrementalParser::closeScope(std::vector<Object> *objects) {
+  bool isArray = scopes_.back();
+  scopes_.pop_back();
+  if (isArray)
+    keys_.pop_back();
+
+  if (scopes_.empty()) {
+    objects->push_back(builder_->Done());
+    builder_.reset();
+    state_ = kRoot;
+    return;
+  }
+
+  if (isArray) {
+    builder_->EndSubArray();
+  } else {
+    builder_->EndSubObject();
+  }
+  state_ = kCommaOrClose;
+}
+
+Status IncrementalParser::fail(Slice msg, const char *p) {
+  std::ostringstream oss;
+  oss << msg;
+  oss << "\noffset:";
+  oss << consumed_ + static_cast<size_t>(p - chunk_);
+  status_ = Status::FailedToParse(oss.str());
+  return status_;
+}
+
+}  // namespace bson
@@ -0,0 +1,145 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DisallowCopying.h"
+#include "ObjectBuilder.h"
+#include "Status.h"
+#include "internal/ArrayKeys.h"
+
+namespace bson {
+
+// IncrementalParser is a push parser for json that arrives in chunks, e.g.
+// from a socket. Each chunk is parsed as soon as it's fed, and the parser
+// keeps its state (the open scopes of the document under construction, and
+// any string, field name or number cut by the end of the chunk) until the
+// next one, so the input never has to be buffered as a whole.
+//
+// The input is a sequence of json documents, optionally separated by
+// whitespaces. It accepts the same syntax as StructuralParser: json, plus
+// Infinity, -Infinity and NaN, with the number grammar of Parser.
+//
+//   IncrementalParser parser;
+//   std::vector<Object> objects;
+//   while (read(fd, buf, sizeof(buf)) > 0) {
+//     if (!(s = parser.Feed(Slice(buf, n), &objects)))
+//       ...
+//   }
+//   s = parser.Finish();
+//
+class IncrementalParser {
+  __DISALLOW_COPYING__(IncrementalParser);
+
+ public:
+  IncrementalParser() {
+    Reset();
+  }
+
+  // Parse the next chunk of input. The documents finished by this chunk are
+  // appended to "objects". The chunk needn't outlive the call.
+  // Once an error is returned, the parser stays failed until Reset().
+  Status Feed(Slice chunk, std::vector<Object> *objects);
+
+  // Indicate the end of input.
+  // @return error if the input ends within a document.
+  Status Finish();
+
+  // Discard the document under construction and any error, so that the
+  // parser can be reused for another stream.
+  void Reset();
+
+  // @return true iff the parser is in the middle of a document.
+  bool InDocument() const {
+    return state_ != kRoot;
+  }
+
+ private:
+  enum State {
+    kRoot,          // expecting { or [ of the next document
+    kFirstOrClose,  // after { or [, expecting the first element or the end
+    kField,         // expecting the opening quote of a field name
+    kInField,       // within a field name
+    kColon,         // expecting : after a field name
+    kValue,         // expecting a value
+    kInString,      // within a string value
+    kInToken,       // within a number or literal
+    kCommaOrClose,  // after an element, expecting , or the end of the scope
+  };
+
+  // Continue the field name or string value at "p".
+  // @return the position after the closing quote, or nullptr if more input is
+  // needed or the string is malformed, which sets the status of the parser.
+  const char *continueString(const char *p, const char *end);
+
+  // Start the value at "p", which isn't a whitespace.
+  // @return the position to continue from.
+  const char *beginValue(const char *p, const char *end);
+
+  // Append the number or literal "token" as a value. Errors are reported at
+  // "p".
+  Status finishScalar(Slice token, const char *p);
+
+  // End the innermost scope, and the document if it's the root.
+  void closeScope(std::vector<Object> *objects);
+
+  // @return field name of the value to be appended, which is the next index
+  // in an array.
+  Slice field() {
+    return scopes_.back() ? keys_.back().Next() : Slice(field_);
+  }
+
+  // Open a scope, which is an array if "isArray".
+  void pushScope(bool isArray) {
+    scopes_.push_back(isArray);
+    if (isArray)
+      keys_.emplace_back();
+  }
+
+  // @return FailedToParse status with the given message and the offset of
+  // "p" in the whole input, which also becomes the status of the parser.
+  Status fail(Slice msg, const char *p);
+
+ private:
+  State state_;
+  Status status_;
+
+  // The document under construction.
+  std::unique_ptr<ObjectBuilder> builder_;
+
+  // Whether each of the open scopes, from the root to the innermost, is an
+  // array.
+  std::vector<bool> scopes_;
+
+  // Keys of the elements of the open arrays, from the outermost.
+  std::vector<internal::ArrayKeys> keys_;
+
+  std::string field_;  // the last field name
+  std::string token_;  // a number or literal cut by the end of the chunk
+  std::string escape_;  // an escape sequence cut by the end of the chunk
+
+  // Bytes of input in the previous chunks, and the current chunk.
+  size_t consumed_;
+  const char *chunk_;
+  size_t chunkLen_;
+};
+
+}  // namespace bson
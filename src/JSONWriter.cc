@@ -0,0 +1,364 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <sys/uio.h>
+#include <cerrno>
+#include <cstring>
+#include <ostream>
+
+#include "JSONWriter.h"
+#include "ValueTypes.h"
+#include "internal/NumberFormatter.h"
+
+namespace bson {
+
+namespace {
+
+// The character following the backslash when a byte is escaped, or 0 if the
+// byte can be written as is. Control characters without a short escape
+// sequence are written as \u00XX.
+const char kEscape[256] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',   // 0x00
+    'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',   // 0x08
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',   // 0x10
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',   // 0x18
+    0,   0,   '"', 0,   0,   0,   0,   0,     // 0x20
+    0,   0,   0,   0,   0,   0,   0,   0,     // 0x28
+    0,   0,   0,   0,   0,   0,   0,   0,     // 0x30
+    0,   0,   0,   0,   0,   0,   0,   0,     // 0x38
+    0,   0,   0,   0,   0,   0,   0,   0,     // 0x40
+    0,   0,   0,   0,   0,   0,   0,   0,     // 0x48
+    0,   0,   0,   0,   0,   0,   0,   0,     // 0x50
+    0,   0,   0,   0,   '\\', 0,  0,   0,     // 0x58
+    // 0x60 - 0xFF are written as is.
+};
+
+const char kHexDigits[] = "0123456789abcdef";
+
+}  // namespace
+
+Status CallbackSink::Consume(const Slice *pieces, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    Status s = cb_(pieces[i]);
+    if (!s)
+      return s;
+  }
+  return Status::OK();
+}
+
+Status OStreamSink::Consume(const Slice *pieces, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    os_.write(pieces[i].RawData(), pieces[i].Len());
+  if (!os_)
+    return Status::IOError("failed to write to the output stream");
+  return Status::OK();
+}
+
+Status FdSink::Consume(const Slice *pieces, size_t n) {
+  // Pieces are written in batches of at most kMaxPieces, however many the
+  // caller passes.
+  enum { kMaxPieces = 8 };
+  struct iovec iov[kMaxPieces];
+
+  size_t i = 0;
+  while (i < n) {
+    int cnt = 0;
+    for (; i < n && cnt < kMaxPieces; i++) {
+      if (pieces[i].Len() == 0)
+        continue;
+      iov[cnt].iov_base = const_cast<char *>(pieces[i].RawData());
+      iov[cnt].iov_len = pieces[i].Len();
+      cnt++;
+    }
+
+    // Retry until the batch is written.
+    struct iovec *v = iov;
+    while (cnt > 0) {
+      ssize_t written = writev(fd_, v, cnt);
+      if (written < 0) {
+        if (errno == EINTR)
+          continue;
+        return Status::IOError(std::string("writev: ") + strerror(errno));
+      }
+
+      size_t left = static_cast<size_t>(written);
+      while (cnt > 0 && left >= v->iov_len) {
+        left -= v->iov_len;
+        v++;
+        cnt--;
+      }
+      if (cnt > 0) {
+        v->iov_base = static_cast<char *>(v->iov_base) + left;
+        v->iov_len -= left;
+      }
+    }
+  }
+  return Status::OK();
+}
+
+Slice JSONWriter::Write(const Object &obj) {
+  sink_ = nullptr;
+  buf_.Clear();
+  writeDocument(obj, false, 0);
+  return Slice(buf_.Buf(), buf_.Len());
+}
+
+Status JSONWriter::Write(const Object &obj, JSONSink *sink, size_t chunkSize) {
+  sink_ = sink;
+  chunkSize_ = chunkSize;
+  sinkStatus_ = Status::OK();
+  buf_.Clear();
+
+  writeDocument(obj, false, 0);
+  if (sinkStatus_ && buf_.Len() > 0) {
+    Slice rest(buf_.Buf(), buf_.Len());
+    sinkStatus_ = sink->Consume(&rest, 1);
+  }
+
+  sink_ = nullptr;
+  buf_.Clear();
+  return sinkStatus_;
+}
+
+void JSONWriter::spill(const char *s, size_t n) {
+  if (sinkStatus_) {
+    Slice pieces[2] = {Slice(buf_.Buf(), buf_.Len()), Slice(s, n)};
+    sinkStatus_ = sink_->Consume(pieces, 2);
+  }
+  buf_.Clear();
+}
+
+void JSONWriter::writeDocument(const ObjectView &doc, bool isArray,
+                               int depth) {
+  put(isArray ? '[' : '{');
+
+  bool first = true;
+  for (auto it = doc.begin(); it != doc.end(); it++) {
+    // Give up as soon as the sink fails.
+    if (sink_ && !sinkStatus_)
+      return;
+
+    const Element &e = *it;
+    if (!first)
+      put(',');
+    first = false;
+
+    newLine(depth + 1);
+    if (!isArray) {
+      writeString(e.RawFieldName(), e.FieldNameSize() - 1);
+      if (format_ == kPretty)
+        append(": ", 2);
+      else
+        put(':');
+    }
+    writeValue(e, depth + 1);
+  }
+
+  if (!first)
+    newLine(depth);
+  put(isArray ? ']' : '}');
+}
+
+void JSONWriter::writeValue(const Element &e, int depth) {
+  char num[internal::kMaxNumberLength];
+
+  switch (e.Type()) {
+    case kNumberInt:
+      append(num, internal::FormatInt32(e.ValueOf<int>(), num) - num);
+      break;
+    case kNumberLong:
+      append(num, internal::FormatInt64(e.ValueOf<long long>(), num) - num);
+      break;
+    case kNumberDouble:
+      append(num, internal::FormatDouble(e.ValueOf<double>(), num) - num);
+      break;
+    case kString: {
+      Slice s = e.ValueOf<Slice>();
+      writeString(s.RawData(), s.Len());
+      break;
+    }
+    case kBoolean:
+      if (e.ValueOf<bool>())
+        append("true", 4);
+      else
+        append("false", 5);
+      break;
+    case kNull:
+      append("null", 4);
+      break;
+    case kDatetime: {
+      int64_t t = e.ValueOf<UnixTimestamp>().MicrosSinceEpoch();
+      append("Datetime(", 9);
+      append(num, internal::FormatInt64(t, num) - num);
+      put(')');
+      break;
+    }
+    case kObject:
+    case kArray: {
+      writeDocument(e.ValueOf<ObjectView>(), e.Type() == kArray, depth);
+      break;
+    }
+    case kObjectId: {
+      std::string hex = e.ValueOf<ObjectId>().ToString();
+      append("ObjectId(", 9);
+      writeString(hex.data(), hex.size());
+      put(')');
+      break;
+    }
+    case kBinData: {
+      BinData bin = e.ValueOf<BinData>();
+      append("BinData(", 8);
+      append(num, internal::FormatInt32(bin.subtype, num) - num);
+      putArgSeparator();
+      put('"');
+      writeBase64(bin.data);
+      append("\")", 2);
+      break;
+    }
+    case kTimestamp: {
+      Timestamp ts = e.ValueOf<Timestamp>();
+      append("Timestamp(", 10);
+      append(num, internal::FormatInt64(ts.seconds, num) - num);
+      putArgSeparator();
+      append(num, internal::FormatInt64(ts.increment, num) - num);
+      put(')');
+      break;
+    }
+    case kNumberDecimal: {
+      std::string d = e.ValueOf<Decimal128>().ToString();
+      append("NumberDecimal(", 14);
+      writeString(d.data(), d.size());
+      put(')');
+      break;
+    }
+    case kRegex: {
+      Regex re = e.ValueOf<Regex>();
+      put('/');
+      append(re.pattern.RawData(), re.pattern.Len());
+      put('/');
+      append(re.options.RawData(), re.options.Len());
+      break;
+    }
+    case kCode: {
+      Slice code = e.ValueOf<Code>().code;
+      append("Code(", 5);
+      writeString(code.RawData(), code.Len());
+      put(')');
+      break;
+    }
+    case kCodeWScope: {
+      CodeWScope cws = e.ValueOf<CodeWScope>();
+      append("Code(", 5);
+      writeString(cws.code.RawData(), cws.code.Len());
+      putArgSeparator();
+      writeDocument(cws.scope, false, depth);
+      put(')');
+      break;
+    }
+    case kSymbol: {
+      Slice sym = e.ValueOf<Symbol>().symbol;
+      writeString(sym.RawData(), sym.Len());
+      break;
+    }
+    case kDBPointer: {
+      DBPointer ptr = e.ValueOf<DBPointer>();
+      std::string hex = ptr.id.ToString();
+      append("DBPointer(", 10);
+      writeString(ptr.ns.RawData(), ptr.ns.Len());
+      putArgSeparator();
+      append("ObjectId(", 9);
+      writeString(hex.data(), hex.size());
+      append("))", 2);
+      break;
+    }
+    case kUndefined:
+      append("undefined", 9);
+      break;
+    case kMinKey:
+      append("MinKey", 6);
+      break;
+    case kMaxKey:
+      append("MaxKey", 6);
+      break;
+    default:
+      BOOST_ASSERT_MSG(0, "Unexpected type of value in BSON object.");
+      append("null", 4);
+  }
+}
+
+void JSONWriter::writeBase64(Slice data) {
+  static const char kBase64[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  const unsigned char *p = reinterpret_cast<const unsigned char *>(
+      data.RawData());
+  size_t n = data.Len();
+  for (; n >= 3; p += 3, n -= 3) {
+    char quad[4] = {kBase64[p[0] >> 2],
+                    kBase64[(p[0] & 0x3) << 4 | p[1] >> 4],
+                    kBase64[(p[1] & 0xF) << 2 | p[2] >> 6],
+                    kBase64[p[2] & 0x3F]};
+    append(quad, 4);
+  }
+  if (n > 0) {
+    unsigned char b1 = n > 1 ? p[1] : 0;
+    char quad[4] = {kBase64[p[0] >> 2], kBase64[(p[0] & 0x3) << 4 | b1 >> 4],
+                    n > 1 ? kBase64[(b1 & 0xF) << 2] : '=', '='};
+    append(quad, 4);
+  }
+}
+
+void JSONWriter::writeString(const char *s, size_t len) {
+  put('"');
+
+  const char *end = s + len;
+  const char *run = s;
+  for (const char *p = s; p < end; p++) {
+    char esc = kEscape[static_cast<unsigned char>(*p)];
+    if (!esc)
+      continue;
+
+    append(run, p - run);
+    run = p + 1;
+
+    char seq[6] = {'\\', esc};
+    if (esc == 'u') {
+      seq[2] = '0';
+      seq[3] = '0';
+      seq[4] = kHexDigits[static_cast<unsigned char>(*p) >> 4];
+      seq[5] = kHexDigits[*p & 0xF];
+      append(seq, 6);
+    } else {
+      append(seq, 2);
+    }
+  }
+  append(run, end - run);
+
+  put('"');
+}
+
+void JSONWriter::newLine(int depth) {
+  if (format_ != kPretty)
+    return;
+
+  put('\n');
+  for (int i = 0; i < depth; i++)
+    append("  ", 2);
+}
+
+}  // namespace bson
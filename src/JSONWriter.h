@@ -0,0 +1,170 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <functional>
+#include <iosfwd>
+
+#include "BufBuilder.h"
+#include "DisallowCopying.h"
+#include "Object.h"
+#include "Status.h"
+
+namespace bson {
+
+// Output formats of JSONWriter.
+enum JSONFormat_t {
+  // No whitespace at all.
+  kCompact = 0,
+
+  // One element per line, indented by two spaces per level of nesting.
+  kPretty = 1,
+};
+
+// JSONSink receives the output of JSONWriter piece by piece, in order. The
+// pieces are only valid during the call.
+class JSONSink {
+ public:
+  virtual ~JSONSink() = default;
+
+  // @return any error to stop the writer.
+  virtual Status Consume(const Slice *pieces, size_t n) = 0;
+};
+
+// Passes every piece to a callback.
+class CallbackSink : public JSONSink {
+ public:
+  typedef std::function<Status(Slice)> Callback;
+
+  explicit CallbackSink(Callback cb) : cb_(std::move(cb)) {}
+
+  Status Consume(const Slice *pieces, size_t n) override;
+
+ private:
+  Callback cb_;
+};
+
+class OStreamSink : public JSONSink {
+ public:
+  explicit OStreamSink(std::ostream &os) : os_(os) {}
+
+  Status Consume(const Slice *pieces, size_t n) override;
+
+ private:
+  std::ostream &os_;
+};
+
+// Writes to a file descriptor, all pieces at once with writev. The file
+// descriptor is not closed by the sink.
+class FdSink : public JSONSink {
+ public:
+  explicit FdSink(int fd) : fd_(fd) {}
+
+  Status Consume(const Slice *pieces, size_t n) override;
+
+ private:
+  const int fd_;
+};
+
+// JSONWriter serializes BSON objects into json text, in the syntax accepted
+// by the recursive-descent Parser:
+//
+// - Doubles are always written with a '.' or an exponent, so that they are
+//   parsed back as doubles. Infinite values are written as Infinity and
+//   -Infinity, and NaN as NaN.
+// - Datetimes are written as Datetime(<int64>).
+//
+// The other BSON types have no json counterpart, they're written in the
+// syntax of the mongo shell, e.g ObjectId("<hex>"), BinData(<subtype>,
+// "<base64>"), Timestamp(<seconds>, <increment>), NumberDecimal("<value>"),
+// /<pattern>/<options>, MinKey and MaxKey. The Parser doesn't read these back.
+//
+// The output buffer is reused across calls of Write, so a long-lived writer
+// stops allocating once the buffer is large enough for its objects. When
+// writing to a JSONSink, the buffer is handed to the sink each time it
+// reaches the chunk size, so memory use doesn't grow with the object.
+//
+class JSONWriter {
+  __DISALLOW_COPYING__(JSONWriter);
+
+ public:
+  enum { kDefaultChunkSize = 64 * 1024 };
+
+  explicit JSONWriter(JSONFormat_t format = kCompact)
+      : format_(format), sink_(nullptr), chunkSize_(0) {}
+
+  // Serialize "obj", replacing the output of the previous call.
+  // @return the json text, which is valid until the next call of Write.
+  Slice Write(const Object &obj);
+
+  // Serialize "obj" into "sink". The output is delivered in chunks of at
+  // least "chunkSize" bytes, except the last one, while no more than
+  // "chunkSize" bytes are buffered by the writer.
+  // @return the first error returned by the sink, after which nothing more is
+  // delivered.
+  Status Write(const Object &obj, JSONSink *sink,
+               size_t chunkSize = kDefaultChunkSize);
+
+ private:
+  void writeDocument(const ObjectView &doc, bool isArray, int depth);
+
+  void writeValue(const Element &e, int depth);
+
+  // Write a quoted string with the characters escaped as json requires.
+  void writeString(const char *s, size_t len);
+
+  void writeBase64(Slice data);
+
+  // Start a new line at the given nesting depth, in pretty format.
+  void newLine(int depth);
+
+  // Separate the arguments of Timestamp(...) and the like, with a space in
+  // pretty format only.
+  void putArgSeparator() {
+    if (format_ == kPretty)
+      append(", ", 2);
+    else
+      put(',');
+  }
+
+  void put(char c) {
+    append(&c, 1);
+  }
+
+  void append(const char *s, size_t n) {
+    if (sink_ && buf_.Len() + n > chunkSize_) {
+      spill(s, n);
+      return;
+    }
+    buf_.AppendBuf(s, n);
+  }
+
+  // Deliver the buffered output followed by "s" to the sink.
+  void spill(const char *s, size_t n);
+
+ private:
+  const JSONFormat_t format_;
+  BufBuilder buf_;
+
+  // Only valid during Write(obj, sink, chunkSize).
+  JSONSink *sink_;
+  size_t chunkSize_;
+  Status sinkStatus_;
+};
+
+}  // namespace bson
@@ -15,13 +15,15 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cstdlib>
+#include <cstring>
 #include <sstream>
 
 #include "Object.h"
 
 namespace bson {
 
-std::string Object::Dump() const {
+std::string ObjectView::Dump() const {
   std::ostringstream oss;
   for (ConstIterator i = begin(); i != end(); i++) {
     const Element &e = *i;
@@ -31,4 +33,13 @@ std::string Object::Dump() const {
   return oss.str();
 }
 
+Object ObjectView::Own() const {
+  size_t size = TotalSize();
+  char *block =
+      static_cast<char *>(std::malloc(SharedBuffer::kHeaderSize + size));
+  BOOST_ASSERT_MSG(block != nullptr, "out of memory in ObjectView::Own");
+  std::memcpy(block + SharedBuffer::kHeaderSize, data_, size);
+  return Object(SharedBuffer::Adopt(block, &std::free));
+}
+
 }  // namespace bson
@@ -17,38 +17,56 @@
 
 #pragma once
 
+#include <memory>
+
 #include "Element.h"
+#include "SharedBuffer.h"
 #include "Slice.h"
+#include "internal/FieldIndex.h"
 #include "internal/ObjectIterator.h"
 
 namespace bson {
 
-// A BSON object is an unordered set of name/value pairs. @see ObjectBuilder.h
-// for the format of BSON object.
-// Object represents a block of binary data constructed from ObjectBuilder.
-// The lifetime of the internal binary data is managed by reference counting, if
-// no instance of Object or BSONBuilder holds the data, it will be freed.
-//
+class Object;
 
-typedef std::shared_ptr<const char> SharedBuffer;
+// ObjectView is a non-owning view of a BSON object living in memory that is
+// owned by someone else, e.g a network buffer or a mmapped file. It's only a
+// few pointers, so it's trivially copyable and cheap to pass by value, and it
+// supports the same read-only API as Object. The caller must keep the
+// underlying bytes alive and unmodified for as long as the view is in use;
+// call Own() to get an Object that outlives them.
+//
+// Every Object is an ObjectView, so functions that only read a document can
+// take an ObjectView and accept both.
 
-class Object {
+class ObjectView {
+ protected:
   static const size_t SZ_TotalSize = 4;
   static const size_t SZ_EOO = 1;
 
-  template <bool IsConst> friend class internal::ObjectIterator;
+  // {} (the terminating '\0' of the literal is the EOO)
+  static constexpr const char *kEmptyObject = "\x05\x00\x00\x00";
 
  public:
-  Object(const SharedBuffer &sharedBuf)
-      : sbuf_(sharedBuf), data_(sharedBuf.get()), end_(data_) {
-    end_ = data_ + ConstDataView(data_).ReadNum<int>() - SZ_EOO;
-  }
+  // A view of an empty object.
+  ObjectView()
+      : data_(kEmptyObject), end_(data_ + SZ_TotalSize) {}
 
-  // intentionally copyable
+  // "data" must point to a complete BSON object, whose size is read from
+  // its leading int32.
+  explicit ObjectView(const char *data)
+      : data_(data),
+        end_(data + ConstDataView(data).ReadNum<int>() - SZ_EOO) {}
+
+  // intentionally copyable, copies share the buffer
 
   // (DEBUG)
   std::string Dump() const;
 
+  // Copy the viewed bytes into a newly allocated buffer owned by the returned
+  // Object.
+  Object Own() const;
+
  public:
   //
   // "begin" and "end" function in stdlib-style, so that we're able to use the
@@ -56,42 +74,20 @@ class Object {
   //
 
   typedef internal::ObjectIterator<true> ConstIterator;
-  typedef internal::ObjectIterator<false> Iterator;
-
-  Iterator begin() {
-    return Iterator(data_ + SZ_TotalSize, *this);
-  }
 
   ConstIterator begin() const {
-    return ConstIterator(data_ + SZ_TotalSize, *this);
-  }
-
-  Iterator end() {
-    return Iterator(end_, *this);
+    return ConstIterator(data_ + SZ_TotalSize);
   }
 
   ConstIterator end() const {
-    return ConstIterator(end_, *this);
+    return ConstIterator(end_);
   }
 
   // Search the bson object for an element of the specified field name, if found
-  // it returns an iterator, otherwise it returns an iterator to Object::end().
-  Iterator find(Slice field) {
-    for (auto it = begin(); it != end(); it++) {
-      if (strcmp(field.RawData(), it->RawFieldName()) == 0) {
-        return it;
-      }
-    }
-    return end();
-  }
-
+  // it returns an iterator, otherwise it returns an iterator to end().
+  // It takes O(n) time, views aren't indexed. @see Object::BuildIndex
   ConstIterator find(Slice field) const {
-    for (auto it = begin(); it != end(); it++) {
-      if (strcmp(field.RawData(), it->RawFieldName()) == 0) {
-        return it;
-      }
-    }
-    return end();
+    return ConstIterator(lookup(field, nullptr));
   }
 
  public:
@@ -117,7 +113,9 @@ class Object {
     return find(field) != end();
   }
 
-  Element &operator[](Slice field) {
+  // The field must exist. Element is returned by value since it only points
+  // into the object, and the iterator it was found with is gone.
+  Element operator[](Slice field) const {
     return *find(field);
   }
 
@@ -126,14 +124,110 @@ class Object {
     return static_cast<size_t>(ConstDataView(data_).ReadNum<int>());
   }
 
+ protected:
+  // @return the element named "field", or end_. It's looked up in "index"
+  // unless it's nullptr.
+  const char *lookup(Slice field, const internal::FieldIndex *index) const {
+    if (index) {
+      uint32_t offset = index->Find(data_, field);
+      return offset ? data_ + offset : end_;
+    }
+    for (const char *p = data_ + SZ_TotalSize; p < end_;) {
+      Element e(p);
+      if (strcmp(field.RawData(), e.RawFieldName()) == 0)
+        return p;
+      p += e.Size();
+    }
+    return end_;
+  }
+
+ protected:
+  const char *data_;
+  const char *end_;
+};
+
+// A BSON object is an unordered set of name/value pairs. @see ObjectBuilder.h
+// for the format of BSON object.
+// Object represents a block of binary data constructed from ObjectBuilder.
+// The lifetime of the internal binary data is managed by reference counting, if
+// no instance of Object or BSONBuilder holds the data, it will be freed.
+//
+
+class Object : public ObjectView {
+ public:
+  Object(const SharedBuffer &sharedBuf)
+      : ObjectView(sharedBuf.get()), sbuf_(sharedBuf) {}
+
+  // intentionally copyable, copies share the buffer
+
+  // Objects sharing ownership of their buffer are returned as is. Objects
+  // that don't own their bytes, e.g those built in an Arena, are copied into
+  // a buffer of their own.
+  Object Own() const {
+    return sbuf_.use_count() > 0 ? *this : ObjectView::Own();
+  }
+
+  // Index the fields of the object, so that find, HasMember and operator[]
+  // take O(1) time instead of O(n). It's worth it for wide objects that are
+  // looked up repeatedly. The index is shared by the copies of this Object
+  // made afterwards. ObjectViews of it don't use the index, since they may
+  // outlive it.
+  void BuildIndex() {
+    if (!sindex_)
+      sindex_ = std::make_shared<const internal::FieldIndex>(data_);
+  }
+
+  bool IsIndexed() const {
+    return sindex_ != nullptr;
+  }
+
+ public:
+  typedef internal::ObjectIterator<false> Iterator;
+
+  using ObjectView::begin;
+  using ObjectView::end;
+
+  Iterator begin() {
+    return Iterator(data_ + SZ_TotalSize);
+  }
+
+  Iterator end() {
+    return Iterator(end_);
+  }
+
+  // Same as ObjectView::find, in O(1) time if the object is indexed.
+  ConstIterator find(Slice field) const {
+    return ConstIterator(lookup(field, sindex_.get()));
+  }
+
+  Iterator find(Slice field) {
+    return Iterator(lookup(field, sindex_.get()));
+  }
+
+  bool HasMember(Slice field) const {
+    return find(field) != ObjectView::end();
+  }
+
+  Element operator[](Slice field) const {
+    return *find(field);
+  }
+
   const SharedBuffer &ShareFromThis() const {
     return sbuf_;
   }
 
+  // @return the embedded object or array of "e", an element of this object,
+  // in place. It shares the ownership of the buffer of this object, so it
+  // stays valid after this Object is gone, e.g Array(obj.Embedded(obj["a"])).
+  Object Embedded(const Element &e) const {
+    BOOST_ASSERT(e.Type() == kObject || e.Type() == kArray);
+    BOOST_ASSERT(e.RawData() >= data_ && e.RawData() < end_);
+    return Object(SharedBuffer(sbuf_, e.RawValue()));
+  }
+
  private:
-  const char *data_;
-  const char *end_;
   SharedBuffer sbuf_;
+  std::shared_ptr<const internal::FieldIndex> sindex_;
 };
 
 struct Array : public Object {
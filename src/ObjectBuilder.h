@@ -17,11 +17,16 @@
 
 #pragma once
 
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
 #include "Object.h"
 #include "Slice.h"
 #include "DisallowCopying.h"
 #include "BufBuilder.h"
 #include "UnixTimestamp.h"
+#include "ValueTypes.h"
 
 //
 // Foward declaration of UnixTimestamp.
@@ -41,12 +46,80 @@ class ObjectBuilder {
   __DISALLOW_COPYING__(ObjectBuilder);
 
  public:
-  ObjectBuilder() : doneCalled_(false) {
-    // Leave room for 4 bytes "totalSize".
-    buf_.Skip(sizeof(int));
+  ObjectBuilder()
+      : doneCalled_(false),
+        strOffset_(0),
+        arena_(nullptr),
+        pool_(nullptr),
+        hint_(nullptr),
+        refCounting_(kAtomicRefCount) {
+    start();
+  }
 
-    // reserve 1 byte for EOO
-    buf_.ReserveBytes(1);
+  // Build the object in "arena" instead of a buffer of its own. The Objects
+  // obtained from this builder refer to the arena without reference counting,
+  // so they're only valid as long as the arena.
+  explicit ObjectBuilder(Arena *arena)
+      : buf_(BufBuilder::kInlineSize, arena),
+        doneCalled_(false),
+        strOffset_(0),
+        arena_(arena),
+        pool_(nullptr),
+        hint_(nullptr),
+        refCounting_(kAtomicRefCount) {
+    start();
+  }
+
+  // Build the object in a buffer of "pool", starting with room for
+  // "sizeHint" bytes. The buffer goes back to a pool when the last Object
+  // referring to it is gone, @see BufferPool::Recycle.
+  ObjectBuilder(BufferPool *pool, size_t sizeHint)
+      : buf_(SharedBuffer::kHeaderSize + sizeHint, pool),
+        doneCalled_(false),
+        strOffset_(0),
+        arena_(nullptr),
+        pool_(pool),
+        hint_(nullptr),
+        refCounting_(kAtomicRefCount) {
+    start();
+  }
+
+  // Start with a buffer of the size suggested by "hint", and let it know the
+  // size of each object built. @see SizeHint.
+  explicit ObjectBuilder(SizeHint *hint)
+      : buf_(SharedBuffer::kHeaderSize + hint->Get()),
+        doneCalled_(false),
+        strOffset_(0),
+        arena_(nullptr),
+        pool_(nullptr),
+        hint_(hint),
+        refCounting_(kAtomicRefCount) {
+    start();
+  }
+
+  // Start building a new object, as if the builder was just constructed. The
+  // Objects already obtained from it aren't affected.
+  //
+  // The buffer is kept if no Object has taken it. Otherwise a new one is
+  // allocated, as large as the previous object, or as suggested by the
+  // SizeHint of the builder.
+  void Reset() {
+    buf_.Clear();
+    if (sbuf_)
+      buf_.Reserve(headroom() + (hint_ ? hint_->Get() : View().TotalSize()));
+
+    doneCalled_ = false;
+    sbuf_.reset();
+    subDocOffsets_.clear();
+    strOffset_ = 0;
+    start();
+  }
+
+  // Count the references to the Objects built from now on with "counting".
+  // kNonAtomicRefCount is cheaper, but then the Objects and their copies
+  // must not leave the thread. Objects built in an arena aren't counted.
+  void SetRefCounting(RefCounting_t counting) {
+    refCounting_ = counting;
   }
 
   //
@@ -143,6 +216,29 @@ class ObjectBuilder {
     return AppendStr(field, str);
   }
 
+  // Begin a string element whose value is then appended piece by piece with
+  // AppendStrPiece, e.g. while it's being decoded. EndStr() finishes the
+  // element with the NULL terminator and back-patches its size.
+  ObjectBuilder &BeginStr(Slice field) {
+    appendBSONType(Type_t::kString);
+    buf_.AppendStr(field);
+    strOffset_ = buf_.Len();
+    buf_.Skip(sizeof(int));
+    return *this;
+  }
+
+  ObjectBuilder &AppendStrPiece(Slice piece) {
+    buf_.AppendStr(piece, false);
+    return *this;
+  }
+
+  ObjectBuilder &EndStr() {
+    buf_.AppendNum('\0');
+    DataView(buf_.Buf() + strOffset_)
+        .WriteNum(static_cast<int>(buf_.Len() - strOffset_ - sizeof(int)));
+    return *this;
+  }
+
   // Add header for a new subobject.
   ObjectBuilder &AppendSubObjectHeader(Slice field) {
     appendBSONType(Type_t::kObject);
@@ -157,6 +253,35 @@ class ObjectBuilder {
     return *this;
   }
 
+  // Begin an embedded object which is built in place: the following Append***
+  // calls add elements to the embedded object, until the matching
+  // EndSubObject() is called. Embedded objects and arrays can be nested.
+  //
+  // Unlike AppendObject, the elements are written into this builder's buffer
+  // directly, no separate ObjectBuilder or copy is required.
+  ObjectBuilder &BeginSubObject(Slice field) {
+    AppendSubObjectHeader(field);
+    beginSubDocument();
+    return *this;
+  }
+
+  ObjectBuilder &EndSubObject() {
+    endSubDocument();
+    return *this;
+  }
+
+  // Like BeginSubObject, but for an embedded array.
+  ObjectBuilder &BeginSubArray(Slice field) {
+    AppendSubArrayHeader(field);
+    beginSubDocument();
+    return *this;
+  }
+
+  ObjectBuilder &EndSubArray() {
+    endSubDocument();
+    return *this;
+  }
+
   // Append a embedded object.
   ObjectBuilder &AppendObject(Slice field, const Object &obj) {
     appendBSONType(Type_t::kObject);
@@ -191,12 +316,171 @@ class ObjectBuilder {
     return AppendDatetime(field, t);
   }
 
+  ObjectBuilder &AppendObjectId(Slice field, const ObjectId &oid) {
+    appendBSONType(Type_t::kObjectId);
+    buf_.AppendStr(field);
+    buf_.AppendBuf(reinterpret_cast<const char *>(oid.bytes),
+                   sizeof(oid.bytes));
+    return *this;
+  }
+
+  ObjectBuilder &Append(Slice field, const ObjectId &oid) {
+    return AppendObjectId(field, oid);
+  }
+
+  ObjectBuilder &AppendBinData(Slice field, const BinData &bin) {
+    appendBSONType(Type_t::kBinData);
+    buf_.AppendStr(field);
+    buf_.AppendNum(static_cast<int>(bin.data.Len()));
+    buf_.AppendNum(static_cast<char>(bin.subtype));
+    buf_.AppendBuf(bin.data.RawData(), bin.data.Len());
+    return *this;
+  }
+
+  ObjectBuilder &Append(Slice field, const BinData &bin) {
+    return AppendBinData(field, bin);
+  }
+
+  ObjectBuilder &AppendTimestamp(Slice field, const Timestamp &ts) {
+    appendBSONType(Type_t::kTimestamp);
+    buf_.AppendStr(field);
+    buf_.AppendNum(ts.increment);
+    buf_.AppendNum(ts.seconds);
+    return *this;
+  }
+
+  ObjectBuilder &Append(Slice field, const Timestamp &ts) {
+    return AppendTimestamp(field, ts);
+  }
+
+  ObjectBuilder &AppendDecimal(Slice field, const Decimal128 &d) {
+    appendBSONType(Type_t::kNumberDecimal);
+    buf_.AppendStr(field);
+    buf_.AppendNum(d.low);
+    buf_.AppendNum(d.high);
+    return *this;
+  }
+
+  ObjectBuilder &Append(Slice field, const Decimal128 &d) {
+    return AppendDecimal(field, d);
+  }
+
+  ObjectBuilder &AppendRegex(Slice field, const Regex &re) {
+    appendBSONType(Type_t::kRegex);
+    buf_.AppendStr(field);
+    buf_.AppendStr(re.pattern);
+    buf_.AppendStr(re.options);
+    return *this;
+  }
+
+  ObjectBuilder &Append(Slice field, const Regex &re) {
+    return AppendRegex(field, re);
+  }
+
+  ObjectBuilder &AppendCode(Slice field, const Code &code) {
+    appendBSONType(Type_t::kCode);
+    buf_.AppendStr(field);
+    buf_.AppendNum(static_cast<int>(code.code.Len() + 1));
+    buf_.AppendStr(code.code);
+    return *this;
+  }
+
+  ObjectBuilder &Append(Slice field, const Code &code) {
+    return AppendCode(field, code);
+  }
+
+  ObjectBuilder &AppendSymbol(Slice field, const Symbol &sym) {
+    appendBSONType(Type_t::kSymbol);
+    buf_.AppendStr(field);
+    buf_.AppendNum(static_cast<int>(sym.symbol.Len() + 1));
+    buf_.AppendStr(sym.symbol);
+    return *this;
+  }
+
+  ObjectBuilder &Append(Slice field, const Symbol &sym) {
+    return AppendSymbol(field, sym);
+  }
+
+  //  code_w_s ::= int32 string document
+  //  where the int32 is the size of the whole value including itself.
+  ObjectBuilder &AppendCodeWScope(Slice field, const CodeWScope &cws) {
+    appendBSONType(Type_t::kCodeWScope);
+    buf_.AppendStr(field);
+    size_t size = sizeof(int) + sizeof(int) + cws.code.Len() + 1 +
+                  cws.scope.TotalSize();
+    buf_.AppendNum(static_cast<int>(size));
+    buf_.AppendNum(static_cast<int>(cws.code.Len() + 1));
+    buf_.AppendStr(cws.code);
+    buf_.AppendBuf(cws.scope.RawData(), cws.scope.TotalSize());
+    return *this;
+  }
+
+  ObjectBuilder &Append(Slice field, const CodeWScope &cws) {
+    return AppendCodeWScope(field, cws);
+  }
+
+  ObjectBuilder &AppendDBPointer(Slice field, const DBPointer &ptr) {
+    appendBSONType(Type_t::kDBPointer);
+    buf_.AppendStr(field);
+    buf_.AppendNum(static_cast<int>(ptr.ns.Len() + 1));
+    buf_.AppendStr(ptr.ns);
+    buf_.AppendBuf(reinterpret_cast<const char *>(ptr.id.bytes),
+                   sizeof(ptr.id.bytes));
+    return *this;
+  }
+
+  ObjectBuilder &Append(Slice field, const DBPointer &ptr) {
+    return AppendDBPointer(field, ptr);
+  }
+
+  ObjectBuilder &Append(Slice field, Undefined) {
+    appendBSONType(Type_t::kUndefined);
+    buf_.AppendStr(field);
+    return *this;
+  }
+
+  ObjectBuilder &Append(Slice field, MinKey) {
+    appendBSONType(Type_t::kMinKey);
+    buf_.AppendStr(field);
+    return *this;
+  }
+
+  ObjectBuilder &Append(Slice field, MaxKey) {
+    appendBSONType(Type_t::kMaxKey);
+    buf_.AppendStr(field);
+    return *this;
+  }
+
+  // @return the number of bytes appended so far, including the leading
+  // "totalSize".
+  size_t Len() const {
+    return buf_.Len() - headroom();
+  }
+
+  // Discard everything appended after the first "len" bytes, including any
+  // embedded object or array begun since then, e.g. to drop an element which
+  // was only partially appended when an error occurred.
+  void Truncate(size_t len) {
+    BOOST_ASSERT(!doneCalled_ && len >= sizeof(int) && len <= Len());
+    len += headroom();
+    while (!subDocOffsets_.empty() && subDocOffsets_.back() >= len) {
+      subDocOffsets_.pop_back();
+      buf_.ClaimReservedBytes(1);
+    }
+    buf_.Truncate(len);
+  }
+
  public:
   // Finish building.
+  // @param indexFields whether to index the fields of the object.
+  // @see Object::BuildIndex
   // @return Object constructed by this ObjectBuilder.
-  Object Done() {
+  Object Done(bool indexFields = false) {
     DoneFast();
-    return Obj();  // RVO
+    Object obj = Obj();
+    if (indexFields)
+      obj.BuildIndex();
+    return obj;  // NRVO
   }
 
   bool HasDone() const {
@@ -205,21 +489,51 @@ class ObjectBuilder {
 
   // Finish building.
   void DoneFast() {
+    BOOST_ASSERT_MSG(subDocOffsets_.empty(),
+                     "Embedded object or array hasn't been ended.");
     if (!doneCalled_) {
       doneCalled_ = true;
-      appendBSONType(Type_t::kEOO);
       buf_.ClaimReservedBytes(1);
+      appendBSONType(Type_t::kEOO);
 
       // set "totalSize" field of the bson object
-      DataView(buf_.Buf()).WriteNum(static_cast<int>(buf_.Len()));
+      DataView(buf_.Buf() + headroom()).WriteNum(static_cast<int>(Len()));
+      if (hint_)
+        hint_->Update(Len());
     }
   }
 
+  // @return a view of the object finished by DoneFast, without taking the
+  // buffer from the builder. It's valid until the builder is reset,
+  // destroyed or appended to.
+  ObjectView View() const {
+    BOOST_ASSERT_MSG(doneCalled_, "Building of this object hasn't done yet.");
+    return ObjectView(sbuf_ ? sbuf_.get() : buf_.Buf() + headroom());
+  }
+
   // @return Object constructed by this ObjectBuilder.
   Object Obj() {
     BOOST_ASSERT_MSG(doneCalled_, "Building of this object hasn't done yet.");
-    if (sbuf_.get() == nullptr) {
-      sbuf_.reset(buf_.Release());
+    if (sbuf_.get() == nullptr && pool_ && wastesPoolBuffer()) {
+      // Copy the object to a block of its own rather than pinning a mostly
+      // unused pooled buffer for as long as the Object lives. The buffer
+      // stays with the builder.
+      char *block = static_cast<char *>(std::malloc(buf_.Len()));
+      BOOST_ASSERT_MSG(block != nullptr, "out of memory in Obj");
+      memcpy(block, buf_.Buf(), buf_.Len());
+      sbuf_ = SharedBuffer::Adopt(block, &std::free, refCounting_);
+    } else if (sbuf_.get() == nullptr) {
+      char *block = const_cast<char *>(buf_.Release());
+      if (arena_) {
+        // A SharedBuffer aliasing an empty one owns nothing and has no
+        // header, so copying it costs no reference counting.
+        sbuf_ = SharedBuffer(SharedBuffer(), block);
+      } else {
+        // The reference count goes in the room left at the beginning of the
+        // buffer.
+        sbuf_ = SharedBuffer::Adopt(
+            block, pool_ ? &BufferPool::Recycle : &std::free, refCounting_);
+      }
     }
     assert(sbuf_.get() != nullptr);
     return Object(sbuf_);
@@ -236,14 +550,76 @@ class ObjectBuilder {
   }
 
  private:
+  // Leave room for the header of the SharedBuffer and the 4 bytes
+  // "totalSize", and reserve 1 byte for EOO.
+  void start() {
+    buf_.Skip(headroom() + sizeof(int));
+    buf_.ReserveBytes(1);
+  }
+
+  // @return whether the object leaves more than half of its pooled buffer
+  // unused. An object in the inline buffer would be copied to a pooled buffer
+  // of at least kMinBufferSize bytes.
+  bool wastesPoolBuffer() const {
+    size_t cap = buf_.IsInline() ? BufferPool::kMinBufferSize
+                                 : BufferPool::CapacityOf(buf_.Buf());
+    return 2 * buf_.Len() < cap;
+  }
+
+  // @return the room left for the header of the SharedBuffer, none for an
+  // arena.
+  size_t headroom() const {
+    return arena_ ? 0 : SharedBuffer::kHeaderSize;
+  }
+
   inline void appendBSONType(Type_t type) {
     buf_.AppendNum(static_cast<char>(type));
   }
 
+  void beginSubDocument() {
+    // Leave room for the "totalSize" of the embedded document, which is
+    // back-patched once the document ends.
+    subDocOffsets_.push_back(buf_.Len());
+    buf_.Skip(sizeof(int));
+
+    // reserve 1 byte for EOO
+    buf_.ReserveBytes(1);
+  }
+
+  void endSubDocument() {
+    BOOST_ASSERT_MSG(!subDocOffsets_.empty(),
+                     "No embedded object or array to be ended.");
+    size_t offset = subDocOffsets_.back();
+    subDocOffsets_.pop_back();
+
+    buf_.ClaimReservedBytes(1);
+    appendBSONType(Type_t::kEOO);
+    DataView(buf_.Buf() + offset)
+        .WriteNum(static_cast<int>(buf_.Len() - offset));
+  }
+
  private:
   BufBuilder buf_;
   bool doneCalled_;
   SharedBuffer sbuf_;
+
+  // Offsets of the "totalSize" of embedded documents under construction,
+  // from the outermost to the innermost.
+  std::vector<size_t> subDocOffsets_;
+
+  // Offset of the size of the string started by BeginStr.
+  size_t strOffset_;
+
+  // The arena holding the buffer, if any.
+  Arena *arena_;
+
+  // The pool the buffer comes from, if any.
+  BufferPool *pool_;
+
+  // Learns the size of the objects built, if any.
+  SizeHint *hint_;
+
+  RefCounting_t refCounting_;
 };
 
 }  // namespace bson
\ No newline at end of file
@@ -17,12 +17,18 @@
 
 #pragma once
 
+#include <algorithm>
 #include <boost/assert.hpp>
+#include <cmath>
 #include <sstream>
+#include <string>
 
+#include "ArrayBuilder.h"
 #include "DisallowCopying.h"
 #include "ObjectBuilder.h"
 #include "Status.h"
+#include "internal/NumberParser.h"
+#include "internal/Scanner.h"
 
 namespace bson {
 
@@ -34,8 +40,6 @@ static const char *LBRACE = "{", *RBRACE = "}", *LBRACKET = "[",
 #define ALPHA "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
 #define DIGIT "0123456789"
 
-enum { FIELD_RESERVE_SIZE = 4096, STRINGVAL_RESERVE_SIZE = 4096 };
-
 class Parser {
   __DISALLOW_COPYING__(Parser);
 
@@ -56,6 +60,24 @@ class Parser {
     return parseError("Expecting { or [");
   }
 
+  // Like Parse, but the document is built in place as an embedded object or
+  // array named "field" of "builder", rather than as the document of "builder"
+  // itself. On error the embedded document is left unfinished.
+  Status ParseEmbedded(Slice field, ObjectBuilder &builder) {
+    if (advance(LBRACE)) {
+      return parseObject(field, builder);
+    } else if (advance(LBRACKET)) {
+      return parseArray(field, builder);
+    }
+    return parseError("Expecting { or [");
+  }
+
+  // @return the number of bytes of input consumed so far, which is right
+  // after the document once Parse succeeds.
+  size_t Consumed() const {
+    return static_cast<size_t>(cur_ - buf_);
+  }
+
  private:
   //
   // Returns true iff the next non-whitespaces sequence in the buffer matches
@@ -75,14 +97,14 @@ class Parser {
   bool peekImpl(const char *token, bool advanceIn) {
     assert(token != nullptr);
 
+    // Whitespaces are insignificant between tokens, so "cur_" is moved past
+    // them regardless of whether the token matches, which saves the following
+    // token checks from skipping them again.
+    skipWhitespace();
     const char *p = cur_;
 
-    // ignore whitespaces
-    while (p < buf_end_ && isspace(*p))
-      p++;
-
     while ((*token) != '\0') {
-      if ((*p) != (*token) || p >= buf_end_)
+      if (p >= buf_end_ || (*p) != (*token))
         return false;
       p++;
       token++;
@@ -112,29 +134,18 @@ class Parser {
     if (cur_ == buf_end_)
       return parseError("Expecting an }");
 
-    std::unique_ptr<ObjectBuilder> subBuilder;
-    ObjectBuilder *objBuilder = &builder;
-    if (subObj) {
-      subBuilder.reset(new ObjectBuilder());
-      objBuilder = subBuilder.get();
-    }
+    // The embedded object is built in place in the buffer of "builder".
+    if (subObj)
+      builder.BeginSubObject(field);
 
     if (advance(RBRACE)) {
       // empty object
-      // TODO: Optimization on building empty objects.
-      objBuilder->DoneFast();
-      if (subObj) {
-        builder.Append(field, subBuilder->Obj());
-      }
+      endObject(builder, subObj);
       return Status::OK();
     }
 
-    std::string fieldName;
-    fieldName.reserve(FIELD_RESERVE_SIZE);
-
     do {
-      fieldName.clear();
-      Status ret = parsePair(&fieldName, *objBuilder);
+      Status ret = parsePair(builder);
       if (!ret)
         return ret;
     } while (advance(COMMA));
@@ -143,30 +154,32 @@ class Parser {
       return parseError("Expecting } or ,");
     }
 
-    objBuilder->DoneFast();
+    endObject(builder, subObj);
+    return Status::OK();
+  }
+
+  void endObject(ObjectBuilder &builder, bool subObj) {
     if (subObj) {
-      builder.Append(field, subBuilder->Obj());
+      builder.EndSubObject();
+    } else {
+      builder.DoneFast();
     }
-
-    return Status::OK();
   }
 
   //
   // PAIR :
   //     FIELD : VALUE
   //
-  // FIELD_RESERVE_SIZE of bytes must be reserved in "result" before this method
-  // is called.
-  //
-  Status parsePair(std::string *field, ObjectBuilder &builder) {
-    Status ret = parseField(field);
+  Status parsePair(ObjectBuilder &builder) {
+    Slice field(nullptr);
+    Status ret = parseField(&field);
     if (!ret)
       return ret;
 
     if (!advance(COLON))
       return parseError("Expecting :");
 
-    ret = parseValue(*field, builder);
+    ret = parseValue(field, builder);
     if (!ret)
       return ret;
 
@@ -184,29 +197,38 @@ class Parser {
   //
   // Parse the content of FIELD and store the result into "result".
   // Note: iff FIELD is a quoted string, then only content inside quotes are
-  // stored into "result".
+  // stored into "result". "result" refers to the input buffer when there're
+  // no escape sequences in FIELD, otherwise it refers to "field_", which is
+  // valid until the next field is parsed.
   //
-  Status parseField(std::string *result) {
+  Status parseField(Slice *result) {
     if (peek(DOUBLEQUOTE) || peek(SINGLEQUOTE)) {
-      return parseQuotedString(result);
+      char quote = *cur_++;
+      const char *p = internal::FindQuoteOrEscape(cur_, buf_end_, quote);
+      if (p < buf_end_ && *p == quote) {
+        *result = Slice(cur_, static_cast<size_t>(p - cur_));
+        cur_ = p + 1;
+        return Status::OK();
+      }
+
+      field_.clear();
+      p = internal::DecodeQuoted(cur_, buf_end_, quote, [this](Slice piece) {
+        field_.append(piece.RawData(), piece.Len());
+      });
+      if (p == nullptr)
+        return parseError("Unterminated string or malformed \\u escape");
+      cur_ = p;
+      *result = field_;
+      return Status::OK();
     }
 
     //// unquoted field
 
-    // ignore whitespaces
-    while (cur_ < buf_end_ && isspace(*cur_))
-      cur_++;
-
     if (cur_ >= buf_end_)
       return parseError("Expecting field name");
 
     if (strchr(ALPHA "$_", *cur_) == nullptr)
       return parseError("First character in field must be [A-Za-z$_]");
-    cur_++;
-
-    Status ret = parseChars(result, ALPHA DIGIT "$_");
-    if (!ret)
-      return ret;
 
     return parseError("Expecting quoted string");
   }
@@ -218,85 +240,26 @@ class Parser {
   //  | " CHARS "
   //  | ' CHARS '
   //
-  Status parseQuotedString(std::string *result) {
-    Status r;
-    if (advance(DOUBLEQUOTE)) {
-      result->push_back('"');
-      r = parseChars(result, nullptr, DOUBLEQUOTE);
-      if (!r)
-        result->push_back('"');
-    } else if (advance(SINGLEQUOTE)) {
-      result->push_back('\'');
-      r = parseChars(result, nullptr, SINGLEQUOTE);
-      if (!r)
-        result->push_back('\'');
-    }
-    return r;
-  }
-
-  //
-  // @Nullable "allowSet" contains a set of characters that are allowed, if it's
-  // set. Iff not set, it accepts all characters.
-  // @Nullable "terminalSet" contains characters that signal the end.
-  // Note: Character lies in "terminalSet" won't be appended to "result".
+  // Strings without escape sequences are appended straight from the input,
+  // others are decoded directly into the buffer of "builder".
   //
-  Status parseChars(std::string *result, const char *allowSet,
-                    const char *terminalSet = nullptr) {
-    while (cur_ < buf_end_) {
-      if (terminalSet && strchr(terminalSet, *cur_)) {
-        cur_++;  // Skip this terminated character.
-        break;
-      }
-
-      // iff *cur_ is not in allowSet, then finish parsing and return success.
-      if (allowSet && !strchr(allowSet, *cur_)) {
-        return Status::OK();
-      }
-
-      // Two-character escape sequences used in json are defined in ECMA-404
-      // (http://www.ecma-international.org/publications/files/ECMA-ST/ECMA-404.pdf).
-      if (*cur_ == '\\' && cur_ + 1 < buf_end_) {
-        switch (*(++cur_)) {
-          case '"':
-            result->push_back('\"');
-            break;
-          case '\\':
-            result->push_back('\\');
-            break;
-          case '/':
-            result->push_back('/');
-            break;
-          case 'b':
-            result->push_back('\b');
-            break;
-          case 'f':
-            result->push_back('\f');
-            break;
-          case 'n':
-            result->push_back('\n');
-            break;
-          case 'r':
-            result->push_back('\r');
-            break;
-          case 't':
-            result->push_back('\t');
-            break;
-          case 'u':
-            // TODO
-            break;
-          default:
-            // By default pass on the unescaped character (e.g \q to q)
-            result->push_back(*cur_);
-        }
-        cur_++;
-      } else {
-        result->push_back(*cur_++);
-      }
+  Status parseQuotedString(Slice field, ObjectBuilder &builder) {
+    char quote = *cur_++;
+    const char *p = internal::FindQuoteOrEscape(cur_, buf_end_, quote);
+    if (p < buf_end_ && *p == quote) {
+      builder.AppendStr(field, Slice(cur_, static_cast<size_t>(p - cur_)));
+      cur_ = p + 1;
+      return Status::OK();
     }
 
-    if (cur_ >= buf_end_)
-      return parseError("Unexpected end of input");
-
+    builder.BeginStr(field);
+    p = internal::DecodeQuoted(cur_, buf_end_, quote, [&builder](Slice piece) {
+      builder.AppendStrPiece(piece);
+    });
+    if (p == nullptr)
+      return parseError("Unterminated string or malformed \\u escape");
+    builder.EndStr();
+    cur_ = p;
     return Status::OK();
   }
 
@@ -316,6 +279,7 @@ class Parser {
   //
   // | Infinity
   // | -Infinity
+  // | NaN
   //
   // | DATE
   // | REGEX
@@ -349,12 +313,9 @@ class Parser {
         return ret;
       }
     } else if (peek(DOUBLEQUOTE) || peek(SINGLEQUOTE)) {
-      std::string valString;
-      valString.reserve(STRINGVAL_RESERVE_SIZE);
-      ret = parseQuotedString(&valString);
-      if (!ret)
+      if (!(ret = parseQuotedString(field, builder))) {
         return ret;
-      builder.AppendStr(field, valString);
+      }
     } else if (advance("true")) {
       builder.AppendBool(field, true);
     } else if (advance("false")) {
@@ -365,6 +326,8 @@ class Parser {
       builder.AppendDouble(field, std::numeric_limits<double>::infinity());
     } else if (advance("-Infinity")) {
       builder.AppendDouble(field, -std::numeric_limits<double>::infinity());
+    } else if (advance("NaN")) {
+      builder.AppendDouble(field, std::numeric_limits<double>::quiet_NaN());
     } else {
       Status ret;
       if (!(ret = parseNumber(field, builder)))
@@ -384,31 +347,28 @@ class Parser {
   //   | VALUE , ELEMENTS
   //
   // NOTE: left bracket of this array has been skipped.
-  // @param subObj indicates whether a new ObjectBuilder is required.
+  // @param subObj indicates whether this array is embedded in "builder",
+  // rather than being the document of "builder" itself.
   //
   Status parseArray(Slice field, ObjectBuilder &builder, bool subObj = true) {
     if (cur_ == buf_end_) {
       return parseError("Expecting an ]");
     }
 
-    std::unique_ptr<ObjectBuilder> subBuilder;
-    ObjectBuilder *objBuilder = &builder;
-    if (subObj) {
-      subBuilder.reset(new ObjectBuilder());
-      objBuilder = subBuilder.get();
-    }
+    // The embedded array is built in place in the buffer of "builder".
+    if (subObj)
+      builder.BeginSubArray(field);
 
     if (advance(RBRACKET)) {
       // empty array
-      objBuilder->DoneFast();
-      if (subObj) {
-        builder.Append(field, Array(subBuilder->Obj()));
-      }
+      endArray(builder, subObj);
       return Status::OK();
     }
 
+    // The elements are keyed by their indexes.
+    ArrayBuilder array(builder);
     do {
-      Status ret = parseValue(nullptr, *objBuilder);
+      Status ret = parseValue(array.NextKey(), builder);
       if (!ret)
         return ret;
     } while (advance(COMMA));
@@ -416,57 +376,66 @@ class Parser {
     if (!advance(RBRACKET))
       return parseError("Expecting } or ,");
 
-    objBuilder->DoneFast();
+    endArray(builder, subObj);
+    return Status::OK();
+  }
+
+  void endArray(ObjectBuilder &builder, bool subObj) {
     if (subObj) {
-      builder.Append(field, Array(subBuilder->Obj()));
+      builder.EndSubArray();
+    } else {
+      builder.DoneFast();
     }
-    return Status::OK();
   }
 
-  // Number:
-  // Number parsing is based on standard library functions, not
-  // necessarily on the JSON numeric grammar.
+  // NUMBER :
+  //   see internal::ParseNumber
   //
   Status parseNumber(Slice field, ObjectBuilder &builder) {
-    Status ret;
-    char *pendll, *pendd;
-    int err_num;
-
-    // ignore whitespaces
-    while (cur_ < buf_end_ && isspace(*cur_))
-      cur_++;
-
-    // Try parsing double.
-    // Values that can be parsed into double can be parsed into long long as
-    // well.
-    errno = 0;
-    double dr = strtod(cur_, &pendd);
-    err_num = errno;
+    skipWhitespace();
 
-    if (pendd == nullptr) {
+    internal::NumberValue num;
+    const char *pend = internal::ParseNumber(cur_, buf_end_, &num);
+    if (pend == nullptr)
       return parseError("Invalid conversion from string to number");
-    }
 
-    if (err_num == ERANGE) {
-      return parseError("Value cannot fit in double");
+    switch (num.type) {
+      case kNumberInt:
+        builder.AppendInt(field, num.intVal);
+        break;
+      case kNumberLong:
+        builder.AppendLong(field, num.longVal);
+        break;
+      default:
+        if (std::isinf(num.doubleVal))
+          return parseError("Value cannot fit in double");
+        builder.AppendDouble(field, num.doubleVal);
+        break;
     }
+    cur_ = pend;
+    return Status::OK();
+  }
 
-    // Try parsing long long
-    errno = 0;
-    long long llr = strtoll(cur_, &pendll, 10);
-    err_num = errno;
-
-    if (pendll < pendd || err_num == ERANGE) {
-      builder.Append(field, dr);
-      cur_ = pendd;
-    } else if (llr <= std::numeric_limits<int>::max() ||
-               llr >= std::numeric_limits<int>::min()) {
-      builder.Append(field, static_cast<int>(llr));
-      cur_ = pendll;
-    } else {
-      builder.Append(field, llr);
-      cur_ = pendll;
+  // Parses the integer argument of NumberInt, NumberLong and Datetime.
+  // @param what prefixes the error messages.
+  Status parseInteger(const char *what, long long *val) {
+    skipWhitespace();
+
+    internal::NumberValue num;
+    const char *pend = internal::ParseNumber(cur_, buf_end_, &num);
+    if (pend == nullptr || num.type == kNumberDouble) {
+      // Integers beyond the range of int64 are parsed as doubles as well.
+      bool outOfRange = (pend != nullptr);
+      for (const char *p = cur_; outOfRange && p < pend; p++)
+        outOfRange = (*p != '.' && *p != 'e' && *p != 'E');
+      return parseError(std::string(what) +
+                        (outOfRange
+                             ? ": Value cannot fit in int64"
+                             : ": Invalid conversion from string to integer"));
     }
+
+    *val = (num.type == kNumberInt) ? num.intVal : num.longVal;
+    cur_ = pend;
     return Status::OK();
   }
 
@@ -476,27 +445,19 @@ class Parser {
     if (!advance(LPAREN))
       return parseError("Expecting (");
 
-    char *pEnd;
-    int64_t val;
-    int err_num;
-
-    errno = 0;
-    val = strtoll(cur_, &pEnd, 10);
-    err_num = errno;
-
-    if (pEnd == nullptr)
-      return parseError("NumberInt: Invalid conversion from string to integer");
+    long long val;
+    Status ret;
+    if (!(ret = parseInteger("NumberInt", &val)))
+      return ret;
 
-    if (err_num == ERANGE || val > std::numeric_limits<int>::max() ||
+    if (val > std::numeric_limits<int>::max() ||
         val < std::numeric_limits<int>::min())
       return parseError("NumberInt: Value cannot fit in int32");
 
-    cur_ = pEnd;
-
     if (!advance(RPAREN))
       return parseError("Expecting )");
 
-    builder.AppendInt(field, val);
+    builder.AppendInt(field, static_cast<int>(val));
     return Status::OK();
   }
 
@@ -506,22 +467,10 @@ class Parser {
     if (!advance(LPAREN))
       return parseError("Expecting (");
 
-    char *pEnd;
-    int64_t val;
-    int err_num;
-
-    errno = 0;
-    val = strtoll(cur_, &pEnd, 10);
-    err_num = errno;
-
-    if (pEnd == nullptr)
-      return parseError(
-          "NumberLong: Invalid conversion from string to integer");
-
-    if (err_num == ERANGE)
-      return parseError("NumberLong: Value cannot fit in int64");
-
-    cur_ = pEnd;
+    long long val;
+    Status ret;
+    if (!(ret = parseInteger("NumberLong", &val)))
+      return ret;
 
     if (!advance(RPAREN))
       return parseError("Expecting )");
@@ -538,25 +487,14 @@ class Parser {
     if (!advance(LPAREN))
       return parseError("Expecting (");
 
-    char *pEnd;
-    int64_t tm;
-    int err_num;
-
-    errno = 0;
-    tm = strtoll(cur_, &pEnd, 10);
-    err_num = errno;
-
-    if (pEnd == nullptr)
-      return parseError("Datetime: Invalid conversion from string to integer");
-
-    if (err_num == ERANGE)
-      return parseError("Datetime: Value cannot fit in int64");
+    long long tm;
+    Status ret;
+    if (!(ret = parseInteger("Datetime", &tm)))
+      return ret;
 
     if (tm < 0)
       return parseError("Datetime: Negative integer");
 
-    cur_ = pEnd;
-
     if (!advance(RPAREN))
       return parseError("Expecting )");
 
@@ -564,6 +502,10 @@ class Parser {
     return Status::OK();
   }
 
+  // Number of bytes of input following the error position shown by
+  // parseError.
+  enum { kErrorContext = 64 };
+
   // @return FailedToParse status with the given message and some
   // additional context information.
   Status parseError(Slice msg) {
@@ -572,7 +514,8 @@ class Parser {
     oss << "\noffset:";
     oss << offset();
     oss << "\nof:";
-    oss << cur_;
+    // The input may be a large buffer without a terminating null.
+    oss.write(cur_, std::min<std::ptrdiff_t>(buf_end_ - cur_, kErrorContext));
     return Status::FailedToParse(oss.str());
   }
 
@@ -580,10 +523,16 @@ class Parser {
     return cur_ - buf_;
   }
 
+  inline void skipWhitespace() {
+    cur_ = internal::SkipWhitespace(cur_, buf_end_);
+  }
+
  private:
   const char *const buf_;      // the input buffer
   const char *const buf_end_;  // the end of the input buffer
   const char *cur_;            // current position of the buffer
+
+  std::string field_;  // field name decoded from escape sequences
 };
 
 }  // namespace bson
\ No newline at end of file
@@ -0,0 +1,111 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "Element.h"
+#include "Object.h"
+#include "Slice.h"
+
+namespace bson {
+
+// Projection extracts a fixed set of top level fields from objects in a
+// single pass over their elements, instead of a scan per field with
+// operator[]. The pass stops as soon as all the fields are found.
+//
+// The number of fields is part of the type, and the names are copied and
+// measured once when the projection is made, so it's meant to be made once
+// and applied to many objects:
+//
+//  static const auto kProjection = MakeProjection("name", "age", "email");
+//  Element fields[3];
+//  kProjection.Project(obj, fields);
+//
+template <size_t N>
+class Projection {
+  static_assert(N > 0 && N <= 64, "a projection takes 1 to 64 fields");
+
+ public:
+  template <class... Names>
+  explicit Projection(const Names &... names) {
+    static_assert(sizeof...(Names) == N, "wrong number of field names");
+    Slice slices[] = {Slice(names)...};
+    for (size_t i = 0; i < N; i++) {
+      fields_[i].offset = static_cast<uint32_t>(names_.size());
+      fields_[i].len = static_cast<uint32_t>(slices[i].Len());
+      names_.append(slices[i].RawData(), slices[i].Len());
+      names_.push_back('\0');
+    }
+  }
+
+  // Store the element of the Nth field into "results[N]", or an EOO element
+  // if there's no such field. The first element is taken if a field name
+  // appears more than once, as find does.
+  // @return the number of fields that were found.
+  size_t Project(const ObjectView &obj, Element *results) const {
+    for (size_t i = 0; i < N; i++)
+      results[i] = Element();
+
+    const uint64_t all = N == 64 ? ~0ULL : (1ULL << N) - 1;
+    uint64_t found = 0;
+
+    const char *end = obj.RawData() + obj.TotalSize() - 1;
+    for (const char *p = obj.RawData() + 4; p < end && found != all;) {
+      Element e(p);
+      const char *name = e.RawFieldName();
+      size_t len = e.FieldNameSize() - 1;
+
+      for (size_t i = 0; i < N; i++) {
+        if ((found >> i) & 1)
+          continue;
+        if (fields_[i].len == len &&
+            memcmp(names_.data() + fields_[i].offset, name, len) == 0) {
+          results[i] = e;
+          found |= 1ULL << i;
+        }
+      }
+      p += e.Size();
+    }
+    return static_cast<size_t>(__builtin_popcountll(found));
+  }
+
+  Slice Field(size_t i) const {
+    return Slice(names_.data() + fields_[i].offset, fields_[i].len);
+  }
+
+ private:
+  struct FieldName {
+    uint32_t offset;  // of the name in names_
+    uint32_t len;
+  };
+
+  FieldName fields_[N];
+  std::string names_;  // '\0'-terminated names one after another
+};
+
+template <class... Names>
+Projection<sizeof...(Names)> MakeProjection(const Names &... names) {
+  return Projection<sizeof...(Names)>(names...);
+}
+
+}  // namespace bson
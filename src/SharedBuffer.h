@@ -0,0 +1,164 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace bson {
+
+// How the references to a SharedBuffer are counted. Non-atomic counting is
+// cheaper, but then the copies of the buffer's owners (Objects) must all stay
+// on a single thread.
+enum RefCounting_t { kAtomicRefCount, kNonAtomicRefCount };
+
+// SharedBuffer is a reference counted pointer to a buffer of BSON, much like
+// std::shared_ptr<const char>, but the count lives in a header right in front
+// of the buffer, in the same allocation. So there's no separate control block
+// to allocate, and the allocation is released by the function it was adopted
+// with.
+//
+//   +--------+-----------------
+//   | header | bytes of the buffer
+//   +--------+-----------------
+//   ^ block  ^ get()
+//
+// A SharedBuffer may also point into the buffer of another one, sharing its
+// ownership, or refer to memory owned by someone else, without counting.
+class SharedBuffer {
+ public:
+  // Room to be left at the beginning of a block for the header.
+  enum { kHeaderSize = 16 };
+
+  SharedBuffer() : header_(nullptr), data_(nullptr) {}
+
+  // Share the ownership of "owner", pointing to "p" within its buffer. If
+  // "owner" is empty, "p" is referred to with no ownership at all.
+  SharedBuffer(const SharedBuffer &owner, const char *p)
+      : header_(owner.header_), data_(p) {
+    ref();
+  }
+
+  SharedBuffer(const SharedBuffer &other)
+      : header_(other.header_), data_(other.data_) {
+    ref();
+  }
+
+  SharedBuffer(SharedBuffer &&other)
+      : header_(other.header_), data_(other.data_) {
+    other.header_ = nullptr;
+    other.data_ = nullptr;
+  }
+
+  ~SharedBuffer() {
+    unref();
+  }
+
+  SharedBuffer &operator=(const SharedBuffer &other) {
+    SharedBuffer(other).swap(*this);
+    return *this;
+  }
+
+  SharedBuffer &operator=(SharedBuffer &&other) {
+    SharedBuffer(std::move(other)).swap(*this);
+    return *this;
+  }
+
+  // Take the ownership of "block", which is kHeaderSize bytes of room for
+  // the header followed by the buffer. "release" is called with "block" once
+  // the last reference to it is gone.
+  static SharedBuffer Adopt(char *block, void (*release)(void *),
+                            RefCounting_t counting = kAtomicRefCount) {
+    SharedBuffer r;
+    r.header_ = new (block) Header(release, counting == kAtomicRefCount);
+    r.data_ = block + kHeaderSize;
+    return r;
+  }
+
+  void reset() {
+    SharedBuffer().swap(*this);
+  }
+
+  void swap(SharedBuffer &other) {
+    std::swap(header_, other.header_);
+    std::swap(data_, other.data_);
+  }
+
+  const char *get() const {
+    return data_;
+  }
+
+  explicit operator bool() const {
+    return data_ != nullptr;
+  }
+
+  // @return the number of SharedBuffers sharing the ownership of this
+  // buffer, 0 if it isn't owned.
+  long use_count() const {
+    return header_ ? header_->refs.load(std::memory_order_relaxed) : 0;
+  }
+
+ private:
+  struct Header {
+    Header(void (*r)(void *), bool a) : refs(1), atomic(a), release(r) {}
+
+    std::atomic<int> refs;
+    bool atomic;
+    void (*release)(void *);
+  };
+
+  static_assert(sizeof(Header) <= kHeaderSize, "header doesn't fit");
+
+  void ref() {
+    if (!header_)
+      return;
+    if (header_->atomic)
+      header_->refs.fetch_add(1, std::memory_order_relaxed);
+    else
+      header_->refs.store(header_->refs.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_relaxed);
+  }
+
+  void unref() {
+    if (!header_)
+      return;
+
+    int refs;
+    if (header_->atomic) {
+      refs = header_->refs.fetch_sub(1, std::memory_order_acq_rel) - 1;
+    } else {
+      refs = header_->refs.load(std::memory_order_relaxed) - 1;
+      header_->refs.store(refs, std::memory_order_relaxed);
+    }
+
+    if (refs == 0) {
+      void (*release)(void *) = header_->release;
+      header_->~Header();
+      release(header_);
+    }
+  }
+
+ private:
+  Header *header_;
+  const char *data_;
+};
+
+}  // namespace bson
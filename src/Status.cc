@@ -29,6 +29,12 @@ std::string Status::ToString() const {
     case ErrorCodes::kFailedToParse:
       ret = "FailedToParse";
       break;
+    case ErrorCodes::kIOError:
+      ret = "IOError";
+      break;
+    case ErrorCodes::kCorruption:
+      ret = "Corruption";
+      break;
     default:
       ret = "Unknown ErrorCode";
       break;
@@ -39,7 +45,7 @@ std::string Status::ToString() const {
 
 void Status::copy(const Status& rhs) {
   if (!rhs.info_) {
-    info_.release();
+    info_.reset();
   } else if (!info_) {
     info_ =
         std::unique_ptr<ErrorInfo>(new ErrorInfo(rhs.code(), rhs.info_->msg));
@@ -27,7 +27,12 @@ namespace bson {
 //
 class Status {
  private:
-  enum ErrorCodes { kOK = 0, kFailedToParse = 1 };
+  enum ErrorCodes {
+    kOK = 0,
+    kFailedToParse = 1,
+    kIOError = 2,
+    kCorruption = 3
+  };
 
  public:
   // Default Status is an OK status.
@@ -65,6 +70,22 @@ class Status {
     return code() == ErrorCodes::kFailedToParse;
   }
 
+  static Status IOError(const Slice& msg) {
+    return Status(ErrorCodes::kIOError, msg);
+  }
+
+  bool IsIOError() const {
+    return code() == ErrorCodes::kIOError;
+  }
+
+  static Status Corruption(const Slice& msg) {
+    return Status(ErrorCodes::kCorruption, msg);
+  }
+
+  bool IsCorruption() const {
+    return code() == ErrorCodes::kCorruption;
+  }
+
   std::string ToString() const;
 
  private:
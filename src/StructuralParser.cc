@@ -0,0 +1,243 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+#include "StructuralParser.h"
+#include "internal/ArrayKeys.h"
+#include "internal/NumberParser.h"
+#include "internal/Scanner.h"
+
+namespace bson {
+
+namespace {
+
+inline bool tokenEquals(Slice token, const char *literal) {
+  size_t len = strlen(literal);
+  return token.Len() == len && memcmp(token.RawData(), literal, len) == 0;
+}
+
+}  // namespace
+
+Status StructuralParser::Parse(ObjectBuilder &builder) {
+  Status s = index_.Build(Slice(buf_, static_cast<size_t>(buf_end_ - buf_)));
+  if (!s)
+    return s;
+
+  tok_ = index_.begin();
+  tok_end_ = index_.end();
+
+  // A bson object as well as bson array begins with a left brace but without
+  // a specific field name.
+  if (!tokenIs('{') && !tokenIs('['))
+    return parseError("Expecting { or [");
+
+  // Whether each of the open scopes, from the root to the innermost, is an
+  // array. Embedded objects and arrays are built in place in "builder".
+  std::vector<bool> scopes;
+  scopes.push_back(tokenIs('['));
+  tok_++;
+
+  // Keys of the elements of the open arrays, from the outermost.
+  std::vector<internal::ArrayKeys> keys(scopes.back() ? 1 : 0);
+
+  // Whether no element has been parsed in the innermost scope yet.
+  bool first = true;
+
+  while (true) {
+    bool isArray = scopes.back();
+
+    if (tokenIs(isArray ? ']' : '}')) {
+      tok_++;
+      scopes.pop_back();
+      if (isArray)
+        keys.pop_back();
+      if (scopes.empty()) {
+        builder.DoneFast();
+        break;
+      }
+
+      if (isArray) {
+        builder.EndSubArray();
+      } else {
+        builder.EndSubObject();
+      }
+      first = false;
+      continue;
+    }
+
+    if (!first) {
+      if (!tokenIs(','))
+        return parseError(isArray ? "Expecting ] or ," : "Expecting } or ,");
+      tok_++;
+    }
+
+    Slice field(nullptr);
+    if (isArray) {
+      field = keys.back().Next();
+    } else {
+      if (!tokenIs('"'))
+        return parseError("Expecting field name");
+      if (!(s = parseField(buf_ + *tok_, &field)))
+        return s;
+      tok_++;
+
+      if (!tokenIs(':'))
+        return parseError("Expecting :");
+      tok_++;
+    }
+
+    if (tokenIs('{')) {
+      builder.BeginSubObject(field);
+      scopes.push_back(false);
+      tok_++;
+      first = true;
+      continue;
+    }
+
+    if (tokenIs('[')) {
+      builder.BeginSubArray(field);
+      scopes.push_back(true);
+      keys.emplace_back();
+      tok_++;
+      first = true;
+      continue;
+    }
+
+    if (!(s = parseScalar(field, builder)))
+      return s;
+    first = false;
+  }
+
+  if (tok_ != tok_end_)
+    return parseError("Unexpected content after the root");
+  return Status::OK();
+}
+
+// Strings are known to be terminated by the first stage, so decoding them
+// only fails on malformed \u escape sequences.
+
+Status StructuralParser::parseField(const char *p, Slice *result) {
+  p++;
+  const char *q = internal::FindQuoteOrEscape(p, buf_end_, '"');
+  if (q < buf_end_ && *q == '"') {
+    *result = Slice(p, static_cast<size_t>(q - p));
+    return Status::OK();
+  }
+
+  field_.clear();
+  if (!internal::DecodeQuoted(p, buf_end_, '"', [this](Slice piece) {
+        field_.append(piece.RawData(), piece.Len());
+      }))
+    return parseError("Malformed \\u escape");
+  *result = field_;
+  return Status::OK();
+}
+
+Status StructuralParser::parseString(const char *p, Slice field,
+                                     ObjectBuilder &builder) {
+  p++;
+  const char *q = internal::FindQuoteOrEscape(p, buf_end_, '"');
+  if (q < buf_end_ && *q == '"') {
+    builder.AppendStr(field, Slice(p, static_cast<size_t>(q - p)));
+    return Status::OK();
+  }
+
+  builder.BeginStr(field);
+  if (!internal::DecodeQuoted(p, buf_end_, '"', [&builder](Slice piece) {
+        builder.AppendStrPiece(piece);
+      }))
+    return parseError("Malformed \\u escape");
+  builder.EndStr();
+  return Status::OK();
+}
+
+Status StructuralParser::parseScalar(Slice field, ObjectBuilder &builder) {
+  if (tok_ == tok_end_ || strchr("{}[]:,", buf_[*tok_]))
+    return parseError("Expecting value");
+
+  const char *p = buf_ + *tok_;
+  tok_++;
+
+  if (*p == '"')
+    return parseString(p, field, builder);
+
+  // Any other scalar lasts until the next token, excluding the whitespaces in
+  // between.
+  const char *end = (tok_ == tok_end_) ? buf_end_ : buf_ + *tok_;
+  while (internal::IsSpace(end[-1]))
+    end--;
+  Slice token(p, static_cast<size_t>(end - p));
+
+  if (tokenEquals(token, "true")) {
+    builder.AppendBool(field, true);
+  } else if (tokenEquals(token, "false")) {
+    builder.AppendBool(field, false);
+  } else if (tokenEquals(token, "null")) {
+    builder.AppendNull(field);
+  } else if (tokenEquals(token, "Infinity")) {
+    builder.AppendDouble(field, std::numeric_limits<double>::infinity());
+  } else if (tokenEquals(token, "-Infinity")) {
+    builder.AppendDouble(field, -std::numeric_limits<double>::infinity());
+  } else if (tokenEquals(token, "NaN")) {
+    builder.AppendDouble(field, std::numeric_limits<double>::quiet_NaN());
+  } else {
+    return parseNumber(field, token, builder);
+  }
+  return Status::OK();
+}
+
+// Number parsing follows the same rules as Parser::parseNumber, except that
+// the number must span the whole token.
+Status StructuralParser::parseNumber(Slice field, Slice token,
+                                     ObjectBuilder &builder) {
+  internal::NumberValue num;
+  const char *end = token.RawData() + token.Len();
+  if (internal::ParseNumber(token.RawData(), end, &num) != end)
+    return parseError("Invalid conversion from string to number");
+
+  switch (num.type) {
+    case kNumberInt:
+      builder.AppendInt(field, num.intVal);
+      break;
+    case kNumberLong:
+      builder.AppendLong(field, num.longVal);
+      break;
+    default:
+      if (std::isinf(num.doubleVal))
+        return parseError("Value cannot fit in double");
+      builder.AppendDouble(field, num.doubleVal);
+      break;
+  }
+  return Status::OK();
+}
+
+Status StructuralParser::parseError(Slice msg) const {
+  size_t offset = (tok_ == tok_end_) ? static_cast<size_t>(buf_end_ - buf_)
+                                     : static_cast<size_t>(*tok_);
+  std::ostringstream oss;
+  oss << msg;
+  oss << "\noffset:";
+  oss << offset;
+  return Status::FailedToParse(oss.str());
+}
+
+}  // namespace bson
@@ -0,0 +1,89 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "DisallowCopying.h"
+#include "ObjectBuilder.h"
+#include "Status.h"
+#include "internal/StructuralIndex.h"
+
+namespace bson {
+
+// StructuralParser is an alternative to the recursive-descent Parser, which
+// works in two stages:
+//
+// 1. internal::StructuralIndex locates every structural character and the
+//    beginning of every string and scalar token with SIMD.
+// 2. The tokens are then walked in order with an explicit stack of open
+//    scopes, so that no per-byte branching or recursion is involved in
+//    finding them.
+//
+// Only the json syntax is accepted: strings must be double-quoted, and the
+// extended values like NumberInt(...) or Datetime(...) are not supported,
+// except Infinity, -Infinity and NaN. Numbers follow the more lenient grammar
+// of Parser though, e.g "+1", ".5" and "1." are accepted, @see
+// internal::ParseNumber.
+//
+class StructuralParser {
+  __DISALLOW_COPYING__(StructuralParser);
+
+ public:
+  StructuralParser(Slice json)
+      : buf_(json.RawData()), buf_end_(json.RawData() + json.Len()) {}
+
+  Status Parse(ObjectBuilder &builder);
+
+ private:
+  // Parse the field name whose opening quote is at "p". "result" refers to
+  // the input buffer when there're no escape sequences in it, otherwise it
+  // refers to "field_".
+  Status parseField(const char *p, Slice *result);
+
+  // Parse the string whose opening quote is at "p", and append it to
+  // "builder". The string is decoded directly into the buffer of "builder".
+  Status parseString(const char *p, Slice field, ObjectBuilder &builder);
+
+  // Parse the scalar token at the current position, and append it to
+  // "builder".
+  Status parseScalar(Slice field, ObjectBuilder &builder);
+
+  Status parseNumber(Slice field, Slice token, ObjectBuilder &builder);
+
+  // @return true iff the current token is the character "c".
+  bool tokenIs(char c) const {
+    return tok_ != tok_end_ && buf_[*tok_] == c;
+  }
+
+  // @return FailedToParse status with the given message and the offset of
+  // the current token.
+  Status parseError(Slice msg) const;
+
+ private:
+  const char *const buf_;      // the input buffer
+  const char *const buf_end_;  // the end of the input buffer
+
+  internal::StructuralIndex index_;
+  const uint32_t *tok_;      // current token
+  const uint32_t *tok_end_;  // the end of tokens
+
+  std::string field_;  // field name decoded from escape sequences
+};
+
+}  // namespace bson
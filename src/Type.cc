@@ -33,16 +33,40 @@ const char *TypeToString(Type_t t) {
       return "Object";
     case kArray:
       return "Array";
+    case kBinData:
+      return "BinData";
+    case kUndefined:
+      return "Undefined";
+    case kObjectId:
+      return "ObjectId";
     case kBoolean:
       return "Boolean";
+    case kDatetime:
+      return "Datetime";
     case kNull:
       return "Null";
+    case kRegex:
+      return "Regex";
+    case kDBPointer:
+      return "DBPointer";
+    case kCode:
+      return "Code";
+    case kSymbol:
+      return "Symbol";
+    case kCodeWScope:
+      return "CodeWScope";
     case kNumberInt:
       return "NumberInt";
+    case kTimestamp:
+      return "Timestamp";
     case kNumberLong:
       return "NumberLong";
-    case kDatetime:
-      return "Datetime";
+    case kNumberDecimal:
+      return "NumberDecimal";
+    case kMinKey:
+      return "MinKey";
+    case kMaxKey:
+      return "MaxKey";
     default:
       BOOST_ASSERT_MSG(0, "Unknown type");
       return nullptr;
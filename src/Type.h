@@ -24,7 +24,6 @@ namespace bson {
 /**
  * The complete list of BSON types can be found on
  * http://bsonspec.org/spec.html.
- * By now only a subset of them are implemented.
  */
 enum Type_t {
 
@@ -42,23 +41,218 @@ enum Type_t {
   // an embedded array
   kArray = 4,
 
+  // binary data, @see BinData
+  kBinData = 5,
+
+  // deprecated
+  kUndefined = 6,
+
+  kObjectId = 7,
+
   // boolean type
   kBoolean = 8,
 
+  // UTC datetime
+  kDatetime = 9,
+
   kNull = 10,
 
+  // regular expression, @see Regex
+  kRegex = 11,
+
+  // deprecated
+  kDBPointer = 12,
+
+  // JavaScript code
+  kCode = 13,
+
+  // deprecated
+  kSymbol = 14,
+
+  // JavaScript code with scope, @see CodeWScope
+  kCodeWScope = 15,
+
   // 32-bit integers
   kNumberInt = 16,
 
-  // UTC datetime
-  kDatetime = 17,
+  // MongoDB internal timestamp, @see Timestamp
+  kTimestamp = 17,
 
   // 64-bit integers
   kNumberLong = 18,
+
+  // 128-bit IEEE 754-2008 decimal floating point
+  kNumberDecimal = 19,
+
+  // compares lower than all other values. It's 0xFF as a type byte, which
+  // reads back as -1 since type bytes are read as char.
+  kMinKey = -1,
+
+  // compares higher than all other values
+  kMaxKey = 127,
 };
 
 extern const char *TypeToString(Type_t t);
 
+//
+// Value sizes
+//
+
+// How the size of an element's value is determined by its type.
+enum ValueSize_t {
+  // TypeInfo::size bytes.
+  kFixedValue = 0,
+
+  // TypeInfo::size bytes plus the int32 the value starts with, e.g
+  // strings are an int32 length, then as many bytes.
+  kPrefixedValue = 1,
+
+  // Two cstrings, only regular expressions.
+  kRegexValue = 2,
+
+  // Not a BSON type.
+  kInvalidValue = 3,
+};
+
+struct TypeInfo {
+  unsigned char sizing;  // ValueSize_t
+  unsigned char size;
+};
+
+constexpr TypeInfo kInvalidTypeInfo = {kInvalidValue, 0};
+
+// TypeInfo of every possible type byte, so that skipping an element needs no
+// switch over its type. @see Element::Size
+constexpr TypeInfo kTypeInfo[256] = {
+    {kFixedValue, 0},        // 0x00 EOO
+    {kFixedValue, 8},        // 0x01 double
+    {kPrefixedValue, 4},     // 0x02 string
+    {kPrefixedValue, 0},     // 0x03 object
+    {kPrefixedValue, 0},     // 0x04 array
+    {kPrefixedValue, 5},     // 0x05 binary
+    {kFixedValue, 0},        // 0x06 undefined
+    {kFixedValue, 12},       // 0x07 ObjectId
+    {kFixedValue, 1},        // 0x08 boolean
+    {kFixedValue, 8},        // 0x09 datetime
+    {kFixedValue, 0},        // 0x0A null
+    {kRegexValue, 0},        // 0x0B regex
+    {kPrefixedValue, 16},    // 0x0C DBPointer
+    {kPrefixedValue, 4},     // 0x0D code
+    {kPrefixedValue, 4},     // 0x0E symbol
+    {kPrefixedValue, 0},     // 0x0F code w/ scope
+    {kFixedValue, 4},        // 0x10 int32
+    {kFixedValue, 8},        // 0x11 timestamp
+    {kFixedValue, 8},        // 0x12 int64
+    {kFixedValue, 16},       // 0x13 decimal128
+    // 0x14 - 0x7E
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    {kFixedValue, 0},        // 0x7F MaxKey
+    // 0x80 - 0xFE
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    kInvalidTypeInfo, kInvalidTypeInfo, kInvalidTypeInfo,
+    {kFixedValue, 0},        // 0xFF MinKey
+};
+
+// Check the table at compile time: every BSON type has the sizing of the
+// spec, and no other type byte is valid. The entries left out of the
+// initializer would be zeros, i.e valid, so that the count catches them.
+constexpr bool HasTypeInfo(Type_t type, ValueSize_t sizing, int size) {
+  return kTypeInfo[static_cast<unsigned char>(type)].sizing == sizing &&
+         kTypeInfo[static_cast<unsigned char>(type)].size == size;
+}
+
+constexpr int CountValidTypes(int from = 0) {
+  return from == 256 ? 0 : (kTypeInfo[from].sizing != kInvalidValue) +
+                               CountValidTypes(from + 1);
+}
+
+static_assert(HasTypeInfo(kEOO, kFixedValue, 0) &&
+                  HasTypeInfo(kNumberDouble, kFixedValue, 8) &&
+                  HasTypeInfo(kString, kPrefixedValue, 4) &&
+                  HasTypeInfo(kObject, kPrefixedValue, 0) &&
+                  HasTypeInfo(kArray, kPrefixedValue, 0) &&
+                  HasTypeInfo(kBinData, kPrefixedValue, 5) &&
+                  HasTypeInfo(kUndefined, kFixedValue, 0) &&
+                  HasTypeInfo(kObjectId, kFixedValue, 12) &&
+                  HasTypeInfo(kBoolean, kFixedValue, 1) &&
+                  HasTypeInfo(kDatetime, kFixedValue, 8) &&
+                  HasTypeInfo(kNull, kFixedValue, 0) &&
+                  HasTypeInfo(kRegex, kRegexValue, 0) &&
+                  HasTypeInfo(kDBPointer, kPrefixedValue, 16) &&
+                  HasTypeInfo(kCode, kPrefixedValue, 4) &&
+                  HasTypeInfo(kSymbol, kPrefixedValue, 4) &&
+                  HasTypeInfo(kCodeWScope, kPrefixedValue, 0) &&
+                  HasTypeInfo(kNumberInt, kFixedValue, 4) &&
+                  HasTypeInfo(kTimestamp, kFixedValue, 8) &&
+                  HasTypeInfo(kNumberLong, kFixedValue, 8) &&
+                  HasTypeInfo(kNumberDecimal, kFixedValue, 16) &&
+                  HasTypeInfo(kMinKey, kFixedValue, 0) &&
+                  HasTypeInfo(kMaxKey, kFixedValue, 0),
+              "kTypeInfo doesn't match the BSON types");
+static_assert(CountValidTypes() == 22,
+              "kTypeInfo has entries for type bytes that aren't BSON types");
+
+inline const TypeInfo &GetTypeInfo(Type_t type) {
+  return kTypeInfo[static_cast<unsigned char>(type)];
+}
+
+
 //
 // Type traits
 //
@@ -76,21 +270,7 @@ template <> struct is_valid_type<bool> : public std::true_type {};
 template <> struct is_valid_type<std::nullptr_t> : public std::true_type {};
 
 inline bool IsValidType(Type_t type) {
-  switch (type) {
-    case kEOO:
-    case kNumberInt:
-    case kNumberLong:
-    case kNumberDouble:
-    case kNull:
-    case kBoolean:
-    case kString:
-    case kObject:
-    case kArray:
-    case kDatetime:
-      return true;
-    default:
-      return false;
-  }
+  return GetTypeInfo(type).sizing != kInvalidValue;
 }
 
 }  // namespace bson
\ No newline at end of file
@@ -0,0 +1,155 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <cstring>
+#include <string>
+
+#include "DataView.h"
+#include "Type.h"
+#include "Validate.h"
+
+namespace bson {
+
+static Status corruption(const char *what, const char *data, const char *p) {
+  return Status::Corruption(std::string(what) + " at offset " +
+                            std::to_string(p - data));
+}
+
+static int readInt32(const char *p) {
+  return ConstDataView(p).ReadNum<int>();
+}
+
+Status Validate(const char *data, size_t len) {
+  const size_t kMinObjectSize = 5;  // totalSize + EOO
+
+  if (len < kMinObjectSize)
+    return corruption("object shorter than 5 bytes", data, data);
+  int size = readInt32(data);
+  if (size < static_cast<int>(kMinObjectSize) ||
+      static_cast<size_t>(size) > len)
+    return corruption("invalid object size", data, data);
+
+  // The ends of the enclosing objects.
+  const char *ends[kMaxValidateDepth];
+  int depth = 0;
+
+  const char *end = data + size;
+  const char *p = data + 4;
+  for (;;) {
+    if (p >= end)
+      return corruption("missing EOO", data, p);
+
+    const char *elem = p;
+    Type_t type = static_cast<Type_t>(*p++);
+    if (type == kEOO) {
+      if (p != end)
+        return corruption("EOO before the end of object", data, elem);
+      if (depth == 0)
+        return Status::OK();
+      end = ends[--depth];
+      continue;
+    }
+
+    // Field names are usually short, a plain loop beats memchr on them.
+    while (p < end && *p != '\0')
+      p++;
+    if (p == end)
+      return corruption("unterminated field name", data, elem);
+    p++;
+
+    size_t remain = static_cast<size_t>(end - p);
+    const TypeInfo &info = GetTypeInfo(type);
+    size_t valueSize = info.size;
+
+    if (info.sizing == kInvalidValue)
+      return corruption("unknown type", data, elem);
+
+    if (info.sizing == kFixedValue) {
+      if (type == kBoolean && remain >= 1 &&
+          static_cast<unsigned char>(*p) > 1)
+        return corruption("invalid boolean", data, elem);
+    } else if (info.sizing == kRegexValue) {
+      // Pattern and options.
+      const char *q = p;
+      for (int i = 0; i < 2; i++) {
+        while (q < end && *q != '\0')
+          q++;
+        if (q == end)
+          return corruption("unterminated regex", data, elem);
+        q++;
+      }
+      valueSize = static_cast<size_t>(q - p);
+    } else {
+      if (remain < 4)
+        return corruption("truncated value", data, elem);
+      int n = readInt32(p);
+      if (n < 0 || remain < info.size ||
+          static_cast<size_t>(n) > remain - info.size)
+        return corruption("invalid value size", data, elem);
+      valueSize += static_cast<size_t>(n);
+
+      switch (type) {
+        case kString:
+        case kCode:
+        case kSymbol:
+        case kDBPointer:
+          if (n < 1)
+            return corruption("invalid string size", data, elem);
+          if (p[4 + n - 1] != '\0')
+            return corruption("unterminated string", data, elem);
+          break;
+        case kObject:
+        case kArray:
+        case kCodeWScope: {
+          const char *doc = p;
+          size_t docSize = static_cast<size_t>(n);
+          if (type == kCodeWScope) {
+            // int32 size, string, then the scope object taking the rest.
+            if (n < 14)
+              return corruption("invalid code with scope", data, elem);
+            int code = readInt32(p + 4);
+            if (code < 1 || code > n - 13 || p[8 + code - 1] != '\0')
+              return corruption("invalid code with scope", data, elem);
+            doc = p + 8 + code;
+            docSize = static_cast<size_t>(n - 8 - code);
+            if (static_cast<size_t>(readInt32(doc)) != docSize)
+              return corruption("invalid code with scope", data, elem);
+          }
+          if (docSize < kMinObjectSize)
+            return corruption("invalid object size", data, elem);
+          if (depth == kMaxValidateDepth)
+            return corruption("objects nested too deep", data, elem);
+
+          // Descend, the object's elements are checked next.
+          ends[depth++] = end;
+          end = doc + docSize;
+          p = doc + 4;
+          continue;
+        }
+        default:
+          break;
+      }
+    }
+
+    if (valueSize > remain)
+      return corruption("truncated value", data, elem);
+    p += valueSize;
+  }
+}
+
+}  // namespace bson
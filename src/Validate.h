@@ -0,0 +1,44 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+
+#include "Status.h"
+
+namespace bson {
+
+enum { kMaxValidateDepth = 128 };
+
+// Check that "data" holds a well-formed BSON object within its first "len"
+// bytes, so that it can be iterated with no bounds checks: its length and
+// the lengths of all the embedded objects and strings are in bounds, every
+// type byte is known, field names and strings are '\0'-terminated, booleans
+// are 0 or 1, and every object ends with an EOO right at its end.
+//
+// Object, ObjectView and Element trust their bytes, BSON coming from the
+// network or files should be validated before it's used.
+//
+// The object is checked in a single pass without recursion, embedded
+// objects deeper than kMaxValidateDepth are rejected.
+//
+// @return Corruption with the offset of the first error.
+Status Validate(const char *data, size_t len);
+
+}  // namespace bson
@@ -0,0 +1,121 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "ValueTypes.h"
+
+namespace bson {
+
+static const char kHexDigits[] = "0123456789abcdef";
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+std::string ObjectId::ToString() const {
+  std::string ret(sizeof(bytes) * 2, '0');
+  for (size_t i = 0; i < sizeof(bytes); i++) {
+    ret[i * 2] = kHexDigits[bytes[i] >> 4];
+    ret[i * 2 + 1] = kHexDigits[bytes[i] & 0xF];
+  }
+  return ret;
+}
+
+bool ObjectId::FromString(Slice hex, ObjectId *oid) {
+  if (hex.Len() != sizeof(oid->bytes) * 2)
+    return false;
+  for (size_t i = 0; i < sizeof(oid->bytes); i++) {
+    int hi = hexValue(hex.RawData()[i * 2]);
+    int lo = hexValue(hex.RawData()[i * 2 + 1]);
+    if (hi < 0 || lo < 0)
+      return false;
+    oid->bytes[i] = static_cast<unsigned char>(hi << 4 | lo);
+  }
+  return true;
+}
+
+std::string Decimal128::ToString() const {
+  const int kExponentBias = 6176;
+  typedef unsigned __int128 uint128_t;
+
+  bool negative = (high >> 63) != 0;
+  uint64_t combination = (high >> 58) & 0x1F;
+  if (combination == 0x1F)
+    return "NaN";
+  if (combination == 0x1E)
+    return negative ? "-Infinity" : "Infinity";
+
+  int exponent;
+  uint128_t coefficient;
+  if (((high >> 61) & 3) == 3) {
+    // The implied coefficient is always larger than the maximum of
+    // 10^34 - 1, so it's non-canonical and taken as 0.
+    exponent = static_cast<int>((high >> 47) & 0x3FFF);
+    coefficient = 0;
+  } else {
+    exponent = static_cast<int>((high >> 49) & 0x3FFF);
+    coefficient = static_cast<uint128_t>(high & 0x1FFFFFFFFFFFFULL) << 64 | low;
+  }
+  exponent -= kExponentBias;
+
+  uint128_t maxCoefficient = 1;
+  for (int i = 0; i < 34; i++)
+    maxCoefficient *= 10;
+  if (coefficient >= maxCoefficient)
+    coefficient = 0;
+
+  char digits[40];
+  int n = 0;
+  do {
+    digits[n++] = static_cast<char>('0' + static_cast<int>(coefficient % 10));
+    coefficient /= 10;
+  } while (coefficient != 0);
+  std::string d(n, '0');
+  for (int i = 0; i < n; i++)
+    d[i] = digits[n - 1 - i];
+
+  std::string ret = negative ? "-" : "";
+  int adjusted = exponent + n - 1;
+  if (exponent <= 0 && adjusted >= -6) {
+    // Plain notation.
+    if (exponent == 0) {
+      ret += d;
+    } else if (n + exponent > 0) {
+      ret += d.substr(0, n + exponent) + "." + d.substr(n + exponent);
+    } else {
+      ret += "0." + std::string(-(n + exponent), '0') + d;
+    }
+  } else {
+    // Scientific notation.
+    ret += d[0];
+    if (n > 1)
+      ret += "." + d.substr(1);
+    ret += "E";
+    if (adjusted >= 0)
+      ret += "+";
+    ret += std::to_string(adjusted);
+  }
+  return ret;
+}
+
+}  // namespace bson
@@ -0,0 +1,106 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "Object.h"
+#include "Slice.h"
+
+namespace bson {
+
+//
+// Values of the BSON types that have no natural C++ counterpart. They're
+// appended with ObjectBuilder and read with Element::ValueOf, the values read
+// point into the object like Slices do.
+//
+
+// 12-byte ObjectId.
+struct ObjectId {
+  unsigned char bytes[12];
+
+  // @return 24 lowercase hex digits.
+  std::string ToString() const;
+
+  // @param hex 24 hex digits.
+  // @return false if "hex" is not an ObjectId.
+  static bool FromString(Slice hex, ObjectId *oid);
+
+  bool operator==(const ObjectId &rhs) const {
+    return memcmp(bytes, rhs.bytes, sizeof(bytes)) == 0;
+  }
+};
+
+// Binary data of the given subtype, e.g 0x00 for generic binary data, 0x04
+// for UUIDs.
+struct BinData {
+  unsigned char subtype;
+  Slice data;
+};
+
+// MongoDB's internal timestamp.
+struct Timestamp {
+  uint32_t increment;
+  uint32_t seconds;
+};
+
+// IEEE 754-2008 128-bit decimal in the binary integer decimal encoding, as
+// two little-endian halves.
+struct Decimal128 {
+  uint64_t low;
+  uint64_t high;
+
+  // @return the value in the format of MongoDB, e.g "1.5", "1E+3", "NaN".
+  std::string ToString() const;
+};
+
+struct Regex {
+  Slice pattern;
+  Slice options;  // in alphabetical order
+};
+
+// JavaScript code.
+struct Code {
+  Slice code;
+};
+
+// deprecated
+struct Symbol {
+  Slice symbol;
+};
+
+// JavaScript code with the variables it refers to.
+struct CodeWScope {
+  Slice code;
+  ObjectView scope;
+};
+
+// deprecated
+struct DBPointer {
+  Slice ns;
+  ObjectId id;
+};
+
+struct Undefined {};
+struct MinKey {};
+struct MaxKey {};
+
+}  // namespace bson
@@ -0,0 +1,76 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <cstring>
+#include <string>
+
+#include "internal/ArrayKeys.h"
+
+namespace bson {
+
+namespace internal {
+
+namespace {
+
+// Add 1 to the "len" decimal digits at "digits", which are followed by '\0'.
+void incrementDecimal(char *digits, size_t *len) {
+  char *p = digits + *len - 1;
+  while (*p == '9') {
+    *p = '0';
+    if (p == digits) {
+      // all nines, e.g 999 -> 1000
+      *p = '1';
+      digits[*len] = '0';
+      digits[++*len] = '\0';
+      return;
+    }
+    p--;
+  }
+  ++*p;
+}
+
+}  // namespace
+
+Slice ArrayKeys::nextUncached() {
+  if (count_++ == kNumCachedKeys) {
+    static_assert(kNumCachedKeys == 10000, "the first uncached key");
+    memcpy(buf_, "10000", 6);
+    len_ = 5;
+  } else {
+    incrementDecimal(buf_, &len_);
+  }
+  return Slice(buf_, len_);
+}
+
+const char *ArrayKeys::table() {
+  static const std::string keys = [] {
+    std::string s;
+    char digits[8] = "0";
+    size_t len = 1;
+    for (int i = 0; i < kNumCachedKeys; i++) {
+      s.append(digits, len + 1);
+      incrementDecimal(digits, &len);
+    }
+    return s;
+  }();
+  return keys.data();
+}
+
+}  // namespace internal
+
+}  // namespace bson
@@ -0,0 +1,79 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+
+#include "Slice.h"
+
+namespace bson {
+
+namespace internal {
+
+// ArrayKeys generates the keys of the elements of an array, "0", "1", ...,
+// which BSON requires in place of their field names.
+//
+// The keys of the first kNumCachedKeys elements are sliced out of a static
+// table, where they're laid out one after another, each followed by '\0', so
+// that each key begins right after the previous one. The keys after them are
+// counted up in decimal in place, rather than formatted from scratch.
+//
+class ArrayKeys {
+ public:
+  enum { kNumCachedKeys = 10000 };
+
+  ArrayKeys() : key_(table()), len_(1), count_(0), nextWider_(10) {}
+
+  // @return the key of the next element, which is valid until the next call.
+  Slice Next() {
+    if (count_ >= kNumCachedKeys)
+      return nextUncached();
+
+    Slice key(key_, len_);
+    key_ += len_ + 1;
+    if (++count_ == nextWider_) {
+      len_++;
+      nextWider_ *= 10;
+    }
+    return key;
+  }
+
+  // @return the number of keys generated so far.
+  size_t Count() const {
+    return count_;
+  }
+
+ private:
+  // Count up the key in "buf_" past the cached ones.
+  Slice nextUncached();
+
+  // @return the table of the cached keys, built on first use.
+  static const char *table();
+
+ private:
+  const char *key_;  // the next key
+  size_t len_;       // and its length
+  size_t count_;
+  size_t nextWider_;  // when keys get one more digit
+  char buf_[24];      // enough for the digits of any size_t
+};
+
+}  // namespace internal
+
+}  // namespace bson
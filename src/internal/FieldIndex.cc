@@ -0,0 +1,93 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <cstring>
+
+#include "DataView.h"
+#include "Element.h"
+#include "internal/FieldIndex.h"
+
+namespace bson {
+
+namespace internal {
+
+// FNV-1a
+uint32_t FieldIndex::hash(const char *s, size_t len) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    h ^= static_cast<unsigned char>(s[i]);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+FieldIndex::FieldIndex(const char *data) {
+  const size_t kTotalSize = 4;
+  const char *end = data + ConstDataView(data).ReadNum<int>() - 1;
+
+  size_t n = 0;
+  for (const char *p = data + kTotalSize; p < end; p += Element(p).Size())
+    n++;
+
+  // Keep the load factor at most 1/2.
+  size_t cap = 8;
+  while (cap < n * 2)
+    cap *= 2;
+  slots_.assign(cap, Slot{0, 0});
+  mask_ = static_cast<uint32_t>(cap - 1);
+
+  for (const char *p = data + kTotalSize; p < end;) {
+    Element e(p);
+    const char *name = e.RawFieldName();
+    size_t len = e.FieldNameSize() - 1;
+    uint32_t h = hash(name, len);
+
+    for (uint32_t i = h & mask_;; i = (i + 1) & mask_) {
+      Slot &slot = slots_[i];
+      if (slot.offset == 0) {
+        slot.offset = static_cast<uint32_t>(p - data);
+        slot.hash = h;
+        break;
+      }
+      // Duplicated field name, keep the first one.
+      if (slot.hash == h && strcmp(data + slot.offset + 1, name) == 0)
+        break;
+    }
+    p += e.Size();
+  }
+}
+
+uint32_t FieldIndex::Find(const char *data, Slice field) const {
+  size_t len = field.Len();
+  uint32_t h = hash(field.RawData(), len);
+
+  for (uint32_t i = h & mask_;; i = (i + 1) & mask_) {
+    const Slot &slot = slots_[i];
+    if (slot.offset == 0)
+      return 0;
+    if (slot.hash == h) {
+      const char *name = data + slot.offset + 1;
+      if (strncmp(name, field.RawData(), len) == 0 && name[len] == '\0')
+        return slot.offset;
+    }
+  }
+}
+
+}  // namespace internal
+
+}  // namespace bson
@@ -0,0 +1,70 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "DisallowCopying.h"
+#include "Slice.h"
+
+namespace bson {
+
+namespace internal {
+
+// FieldIndex maps the top level field names of a BSON object to the offsets
+// of their elements, so that looking up a field takes O(1) time instead of a
+// scan over all the elements before it.
+//
+// It's an open-addressing hash table with linear probing, at most half full.
+// Each slot holds the 32-bit offset of an element from the beginning of the
+// object and the hash of its field name, so that probing rarely has to
+// compare names. The names themselves are not copied, a lookup needs the
+// object the index was built from.
+//
+// When a field name appears more than once, the first element is indexed,
+// which is what a linear scan finds.
+//
+class FieldIndex {
+  __DISALLOW_COPYING__(FieldIndex);
+
+ public:
+  // Index the object at "data".
+  explicit FieldIndex(const char *data);
+
+  // @return offset of the element named "field" in "data", which must be the
+  // object the index was built from, or 0 if there's no such field.
+  uint32_t Find(const char *data, Slice field) const;
+
+ private:
+  struct Slot {
+    uint32_t offset;  // 0 if the slot is empty
+    uint32_t hash;
+  };
+
+  static uint32_t hash(const char *s, size_t len);
+
+ private:
+  std::vector<Slot> slots_;
+  uint32_t mask_;
+};
+
+}  // namespace internal
+
+}  // namespace bson
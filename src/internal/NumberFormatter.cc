@@ -0,0 +1,441 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "internal/NumberFormatter.h"
+
+namespace bson {
+
+namespace internal {
+
+namespace {
+
+const char kDigitPairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Writes the decimal digits of "val" two at a time from the back of a
+// scratch buffer, then moves them to "buf".
+char *formatUint64(uint64_t val, char *buf) {
+  char tmp[20];
+  char *p = tmp + sizeof(tmp);
+  while (val >= 100) {
+    unsigned i = static_cast<unsigned>(val % 100) * 2;
+    val /= 100;
+    *--p = kDigitPairs[i + 1];
+    *--p = kDigitPairs[i];
+  }
+  if (val >= 10) {
+    unsigned i = static_cast<unsigned>(val) * 2;
+    *--p = kDigitPairs[i + 1];
+    *--p = kDigitPairs[i];
+  } else {
+    *--p = static_cast<char>('0' + val);
+  }
+  size_t len = static_cast<size_t>(tmp + sizeof(tmp) - p);
+  memcpy(buf, p, len);
+  return buf + len;
+}
+
+//
+// Grisu2, from "Printing Floating-Point Numbers Quickly and Accurately with
+// Integers" (Loitsch, 2010).
+//
+
+const int kSignificandBits = 52;
+const uint64_t kHiddenBit = uint64_t(1) << kSignificandBits;
+const uint64_t kSignificandMask = kHiddenBit - 1;
+const int kExponentBias = 0x3FF + kSignificandBits;
+const int kMinExponent = -kExponentBias;
+
+// A floating-point number f * 2^e without any loss of precision.
+struct DiyFp {
+  uint64_t f;
+  int e;
+
+  DiyFp(uint64_t fp, int exp) : f(fp), e(exp) {}
+
+  explicit DiyFp(double d) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    int biasedExp = static_cast<int>((bits >> kSignificandBits) & 0x7FF);
+    uint64_t significand = bits & kSignificandMask;
+    if (biasedExp != 0) {
+      f = significand + kHiddenBit;
+      e = biasedExp - kExponentBias;
+    } else {
+      f = significand;
+      e = kMinExponent + 1;
+    }
+  }
+
+  DiyFp operator-(const DiyFp &rhs) const {
+    return DiyFp(f - rhs.f, e);
+  }
+
+  // Rounded product of the 64 most significant bits.
+  DiyFp operator*(const DiyFp &rhs) const {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 p = static_cast<unsigned __int128>(f) * rhs.f;
+    uint64_t h = static_cast<uint64_t>(p >> 64);
+    uint64_t l = static_cast<uint64_t>(p);
+    if (l & (uint64_t(1) << 63))
+      h++;
+    return DiyFp(h, e + rhs.e + 64);
+#else
+    const uint64_t M32 = 0xFFFFFFFF;
+    uint64_t a = f >> 32, b = f & M32, c = rhs.f >> 32, d = rhs.f & M32;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+    tmp += uint64_t(1) << 31;  // round
+    return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), e + rhs.e + 64);
+#endif
+  }
+
+  DiyFp Normalize() const {
+    int s = __builtin_clzll(f);
+    return DiyFp(f << s, e - s);
+  }
+
+  // Computes the boundaries m- and m+ halfway to the neighbouring doubles,
+  // normalized to the same exponent.
+  void NormalizedBoundaries(DiyFp *minus, DiyFp *plus) const {
+    DiyFp pl = DiyFp((f << 1) + 1, e - 1).Normalize();
+    DiyFp mi = (f == kHiddenBit) ? DiyFp((f << 2) - 1, e - 2)
+                                 : DiyFp((f << 1) - 1, e - 1);
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+    *plus = pl;
+    *minus = mi;
+  }
+};
+
+// Normalized 10^k for k = -348, -340, ..., 340.
+const struct {
+  uint64_t f;
+  int e;
+} kCachedPowers[] = {
+    {0xfa8fd5a0081c0288ULL, -1220},
+    {0xbaaee17fa23ebf76ULL, -1193},
+    {0x8b16fb203055ac76ULL, -1166},
+    {0xcf42894a5dce35eaULL, -1140},
+    {0x9a6bb0aa55653b2dULL, -1113},
+    {0xe61acf033d1a45dfULL, -1087},
+    {0xab70fe17c79ac6caULL, -1060},
+    {0xff77b1fcbebcdc4fULL, -1034},
+    {0xbe5691ef416bd60cULL, -1007},
+    {0x8dd01fad907ffc3cULL, -980},
+    {0xd3515c2831559a83ULL, -954},
+    {0x9d71ac8fada6c9b5ULL, -927},
+    {0xea9c227723ee8bcbULL, -901},
+    {0xaecc49914078536dULL, -874},
+    {0x823c12795db6ce57ULL, -847},
+    {0xc21094364dfb5637ULL, -821},
+    {0x9096ea6f3848984fULL, -794},
+    {0xd77485cb25823ac7ULL, -768},
+    {0xa086cfcd97bf97f4ULL, -741},
+    {0xef340a98172aace5ULL, -715},
+    {0xb23867fb2a35b28eULL, -688},
+    {0x84c8d4dfd2c63f3bULL, -661},
+    {0xc5dd44271ad3cdbaULL, -635},
+    {0x936b9fcebb25c996ULL, -608},
+    {0xdbac6c247d62a584ULL, -582},
+    {0xa3ab66580d5fdaf6ULL, -555},
+    {0xf3e2f893dec3f126ULL, -529},
+    {0xb5b5ada8aaff80b8ULL, -502},
+    {0x87625f056c7c4a8bULL, -475},
+    {0xc9bcff6034c13053ULL, -449},
+    {0x964e858c91ba2655ULL, -422},
+    {0xdff9772470297ebdULL, -396},
+    {0xa6dfbd9fb8e5b88fULL, -369},
+    {0xf8a95fcf88747d94ULL, -343},
+    {0xb94470938fa89bcfULL, -316},
+    {0x8a08f0f8bf0f156bULL, -289},
+    {0xcdb02555653131b6ULL, -263},
+    {0x993fe2c6d07b7facULL, -236},
+    {0xe45c10c42a2b3b06ULL, -210},
+    {0xaa242499697392d3ULL, -183},
+    {0xfd87b5f28300ca0eULL, -157},
+    {0xbce5086492111aebULL, -130},
+    {0x8cbccc096f5088ccULL, -103},
+    {0xd1b71758e219652cULL, -77},
+    {0x9c40000000000000ULL, -50},
+    {0xe8d4a51000000000ULL, -24},
+    {0xad78ebc5ac620000ULL, 3},
+    {0x813f3978f8940984ULL, 30},
+    {0xc097ce7bc90715b3ULL, 56},
+    {0x8f7e32ce7bea5c70ULL, 83},
+    {0xd5d238a4abe98068ULL, 109},
+    {0x9f4f2726179a2245ULL, 136},
+    {0xed63a231d4c4fb27ULL, 162},
+    {0xb0de65388cc8ada8ULL, 189},
+    {0x83c7088e1aab65dbULL, 216},
+    {0xc45d1df942711d9aULL, 242},
+    {0x924d692ca61be758ULL, 269},
+    {0xda01ee641a708deaULL, 295},
+    {0xa26da3999aef774aULL, 322},
+    {0xf209787bb47d6b85ULL, 348},
+    {0xb454e4a179dd1877ULL, 375},
+    {0x865b86925b9bc5c2ULL, 402},
+    {0xc83553c5c8965d3dULL, 428},
+    {0x952ab45cfa97a0b3ULL, 455},
+    {0xde469fbd99a05fe3ULL, 481},
+    {0xa59bc234db398c25ULL, 508},
+    {0xf6c69a72a3989f5cULL, 534},
+    {0xb7dcbf5354e9beceULL, 561},
+    {0x88fcf317f22241e2ULL, 588},
+    {0xcc20ce9bd35c78a5ULL, 614},
+    {0x98165af37b2153dfULL, 641},
+    {0xe2a0b5dc971f303aULL, 667},
+    {0xa8d9d1535ce3b396ULL, 694},
+    {0xfb9b7cd9a4a7443cULL, 720},
+    {0xbb764c4ca7a44410ULL, 747},
+    {0x8bab8eefb6409c1aULL, 774},
+    {0xd01fef10a657842cULL, 800},
+    {0x9b10a4e5e9913129ULL, 827},
+    {0xe7109bfba19c0c9dULL, 853},
+    {0xac2820d9623bf429ULL, 880},
+    {0x80444b5e7aa7cf85ULL, 907},
+    {0xbf21e44003acdd2dULL, 933},
+    {0x8e679c2f5e44ff8fULL, 960},
+    {0xd433179d9c8cb841ULL, 986},
+    {0x9e19db92b4e31ba9ULL, 1013},
+    {0xeb96bf6ebadf77d9ULL, 1039},
+    {0xaf87023b9bf0ee6bULL, 1066},
+};
+
+// @return c_k = 10^-k such that the exponent of c_k * 2^e is in the range
+// [-60, -32], which leaves the integral part of the product in 32 bits.
+DiyFp cachedPower(int e, int *k) {
+  // 1 / log2(10) = 0.30102999566398114
+  double dk = (-61 - e) * 0.30102999566398114 + 347;
+  int ik = static_cast<int>(dk);
+  if (dk - ik > 0.0)
+    ik++;
+  unsigned index = static_cast<unsigned>((ik >> 3) + 1);
+  *k = -(-348 + static_cast<int>(index) * 8);
+  return DiyFp(kCachedPowers[index].f, kCachedPowers[index].e);
+}
+
+const uint64_t kPow10[] = {1ULL,
+                           10ULL,
+                           100ULL,
+                           1000ULL,
+                           10000ULL,
+                           100000ULL,
+                           1000000ULL,
+                           10000000ULL,
+                           100000000ULL,
+                           1000000000ULL,
+                           10000000000ULL,
+                           100000000000ULL,
+                           1000000000000ULL,
+                           10000000000000ULL,
+                           100000000000000ULL,
+                           1000000000000000ULL,
+                           10000000000000000ULL,
+                           100000000000000000ULL,
+                           1000000000000000000ULL,
+                           10000000000000000000ULL};
+
+// Moves the last digit towards the exact value while it stays within the
+// rounding interval.
+void grisuRound(char *buf, int len, uint64_t delta, uint64_t rest,
+                uint64_t tenKappa, uint64_t wpw) {
+  while (rest < wpw && delta - rest >= tenKappa &&
+         (rest + tenKappa < wpw || wpw - rest > rest + tenKappa - wpw)) {
+    buf[len - 1]--;
+    rest += tenKappa;
+  }
+}
+
+int countDecimalDigits(uint32_t n) {
+  int d = 1;
+  while (d < 10 && n >= kPow10[d])
+    d++;
+  return d;
+}
+
+void digitGen(const DiyFp &w, const DiyFp &mp, uint64_t delta, char *buf,
+              int *len, int *k) {
+  const DiyFp one(uint64_t(1) << -mp.e, mp.e);
+  const DiyFp wpw = mp - w;
+  uint32_t p1 = static_cast<uint32_t>(mp.f >> -one.e);
+  uint64_t p2 = mp.f & (one.f - 1);
+  int kappa = countDecimalDigits(p1);
+  *len = 0;
+
+  // Integral part.
+  while (kappa > 0) {
+    uint32_t div = static_cast<uint32_t>(kPow10[kappa - 1]);
+    uint32_t d = p1 / div;
+    p1 %= div;
+    if (d || *len)
+      buf[(*len)++] = static_cast<char>('0' + d);
+    kappa--;
+    uint64_t tmp = (static_cast<uint64_t>(p1) << -one.e) + p2;
+    if (tmp <= delta) {
+      *k += kappa;
+      grisuRound(buf, *len, delta, tmp, kPow10[kappa] << -one.e, wpw.f);
+      return;
+    }
+  }
+
+  // Fractional part.
+  for (;;) {
+    p2 *= 10;
+    delta *= 10;
+    char d = static_cast<char>(p2 >> -one.e);
+    if (d || *len)
+      buf[(*len)++] = static_cast<char>('0' + d);
+    p2 &= one.f - 1;
+    kappa--;
+    if (p2 < delta) {
+      *k += kappa;
+      int index = -kappa;
+      grisuRound(buf, *len, delta, p2, one.f,
+                 wpw.f * (index < 20 ? kPow10[index] : 0));
+      return;
+    }
+  }
+}
+
+// Generates the digits of a positive double: value = digits * 10^k.
+void grisu2(double value, char *buf, int *len, int *k) {
+  const DiyFp v(value);
+  DiyFp mMinus(0, 0), mPlus(0, 0);
+  v.NormalizedBoundaries(&mMinus, &mPlus);
+
+  const DiyFp cmk = cachedPower(mPlus.e, k);
+  const DiyFp w = v.Normalize() * cmk;
+  DiyFp wPlus = mPlus * cmk;
+  DiyFp wMinus = mMinus * cmk;
+  wMinus.f++;
+  wPlus.f--;
+  digitGen(w, wPlus, wPlus.f - wMinus.f, buf, len, k);
+}
+
+char *writeExponent(int k, char *buf) {
+  *buf++ = 'e';
+  if (k < 0) {
+    *buf++ = '-';
+    k = -k;
+  }
+  return formatUint64(static_cast<uint64_t>(k), buf);
+}
+
+// Lays out "len" digits, with the value digits * 10^k, in fixed or
+// exponential notation.
+char *prettify(char *buf, int len, int k) {
+  // 10^(kk - 1) <= value < 10^kk
+  const int kk = len + k;
+
+  if (k >= 0 && kk <= 21) {
+    // 1234e7 -> 12340000000.0
+    memset(buf + len, '0', static_cast<size_t>(k));
+    buf[kk] = '.';
+    buf[kk + 1] = '0';
+    return buf + kk + 2;
+  }
+  if (kk > 0 && kk <= 21) {
+    // 1234e-2 -> 12.34
+    memmove(buf + kk + 1, buf + kk, static_cast<size_t>(len - kk));
+    buf[kk] = '.';
+    return buf + len + 1;
+  }
+  if (kk > -6 && kk <= 0) {
+    // 1234e-6 -> 0.001234
+    const int offset = 2 - kk;
+    memmove(buf + offset, buf, static_cast<size_t>(len));
+    buf[0] = '0';
+    buf[1] = '.';
+    memset(buf + 2, '0', static_cast<size_t>(offset - 2));
+    return buf + len + offset;
+  }
+  if (len == 1) {
+    // 1e30
+    return writeExponent(kk - 1, buf + 1);
+  }
+  // 1234e30 -> 1.234e33
+  memmove(buf + 2, buf + 1, static_cast<size_t>(len - 1));
+  buf[1] = '.';
+  return writeExponent(kk - 1, buf + len + 1);
+}
+
+}  // namespace
+
+char *FormatInt32(int32_t val, char *buf) {
+  uint64_t u = static_cast<uint64_t>(static_cast<int64_t>(val));
+  if (val < 0) {
+    *buf++ = '-';
+    u = 0 - u;
+  }
+  return formatUint64(u, buf);
+}
+
+char *FormatInt64(int64_t val, char *buf) {
+  uint64_t u = static_cast<uint64_t>(val);
+  if (val < 0) {
+    *buf++ = '-';
+    u = 0 - u;
+  }
+  return formatUint64(u, buf);
+}
+
+char *FormatDouble(double val, char *buf) {
+  if (val != val) {
+    memcpy(buf, "NaN", 3);
+    return buf + 3;
+  }
+
+  if (val == 0) {
+    if (std::signbit(val))
+      *buf++ = '-';
+    memcpy(buf, "0.0", 3);
+    return buf + 3;
+  }
+
+  if (val < 0) {
+    *buf++ = '-';
+    val = -val;
+  }
+
+  if (val == std::numeric_limits<double>::infinity()) {
+    memcpy(buf, "Infinity", 8);
+    return buf + 8;
+  }
+
+  int len, k;
+  grisu2(val, buf, &len, &k);
+  return prettify(buf, len, k);
+}
+
+}  // namespace internal
+
+}  // namespace bson
@@ -0,0 +1,49 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace bson {
+
+namespace internal {
+
+// Number formatting primitives used by JSONWriter. Each of them writes the
+// textual form of the number to "buf" without a terminating null, and returns
+// the position right after the last character written.
+
+enum {
+  // Enough room for any number formatted by the functions below.
+  kMaxNumberLength = 32
+};
+
+char *FormatInt32(int32_t val, char *buf);
+
+char *FormatInt64(int64_t val, char *buf);
+
+// Formats a double with the digits generated by Grisu2, which are the
+// shortest ones that parse back to the same double in all but rare cases, and
+// always round-trip. The output always contains a '.' or an exponent, so
+// that it will be parsed as a double rather than as an integer, e.g.
+// "1.0", "0.001", "1.5e-7", "1e300".
+// Infinity and NaN are formatted as "Infinity", "-Infinity" and "NaN".
+char *FormatDouble(double val, char *buf);
+
+}  // namespace internal
+
+}  // namespace bson
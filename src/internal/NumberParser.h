@@ -0,0 +1,58 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "Type.h"
+
+namespace bson {
+
+namespace internal {
+
+// A number parsed by ParseNumber.
+struct NumberValue {
+  // One of kNumberInt, kNumberLong and kNumberDouble.
+  Type_t type;
+
+  union {
+    int intVal;
+    long long longVal;
+    double doubleVal;
+  };
+};
+
+// Parses the number at the beginning of [p, end) in a single pass:
+//
+//   NUMBER : [+-]? DIGITS? ( . DIGITS? )? ( [eE] [+-]? DIGITS )?
+//
+// with at least one digit before the exponent; as with strtod, an exponent
+// without digits isn't part of the number. Integers without fraction and
+// exponent are stored as int32 if they fit, as int64 otherwise, and as double
+// if they don't fit in int64 either. All other numbers are doubles, which
+// are correctly rounded, and are ±infinity if they're out of the range of
+// double.
+//
+// Unlike strtod and strtoll, the input needn't be null-terminated and the
+// current locale has no effect.
+//
+// @return the position right after the number, or nullptr if there's no
+// valid number at "p".
+const char *ParseNumber(const char *p, const char *end, NumberValue *result);
+
+}  // namespace internal
+
+}  // namespace bson
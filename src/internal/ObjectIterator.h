@@ -18,10 +18,8 @@
 #pragma once
 
 #include <silly/IteratorFacade.h>
-#include <Object.h>
 
 #include "Element.h"
-#include "Object.h"
 
 namespace bson {
 
@@ -30,6 +28,10 @@ namespace internal {
 using silly::IteratorFacade;
 using silly::ForwardIteratorTag;
 
+// ObjectIterator holds the element at its position inline, so iterating an
+// object allocates nothing. The element caches the size of its field name
+// and its total size, which are computed once per element and shared by the
+// dereference and the step to the next element.
 template <bool IsConst = true>
 class ObjectIterator : public IteratorFacade<ObjectIterator<IsConst>, Element,
                                               ForwardIteratorTag, IsConst> {
@@ -38,17 +40,9 @@ class ObjectIterator : public IteratorFacade<ObjectIterator<IsConst>, Element,
   typedef typename Facade::Reference Reference;
 
  public:
-  ObjectIterator(const char *data, const Object &obj)
-      : pos_(data), obj_(&obj) {}
+  explicit ObjectIterator(const char *data) : e_(data) {}
 
-  ObjectIterator(const ObjectIterator &other)
-      : pos_(other.pos_), obj_(other.obj_) {}
-
-  ObjectIterator &operator=(const ObjectIterator &other) {
-    pos_ = other.pos_;
-    obj_ = other.obj_;
-    return *this;
-  }
+  // intentionally copyable
 
  private:
   //
@@ -56,26 +50,20 @@ class ObjectIterator : public IteratorFacade<ObjectIterator<IsConst>, Element,
   //
   friend class silly::IteratorCoreAccess;
 
-  // Lazy dereference.
   Reference dereference() const {
-    if (!e_ || e_->RawData() != pos_)
-      e_.reset(new Element(pos_));
-    return *e_;
+    return e_;
   }
 
   void increment() {
-    //    assert(pos_ < obj_->end_);
-    pos_ += Element(pos_).Size();
+    e_ = Element(e_.RawData() + e_.Size());
   }
 
   bool equal(const ObjectIterator &other) const {
-    return pos_ == other.pos_;
+    return e_.RawData() == other.e_.RawData();
   }
 
  private:
-  const char *pos_;
-  const Object *obj_;
-  mutable std::unique_ptr<Element> e_;
+  mutable Element e_;
 };
 
 }  // namespace internal
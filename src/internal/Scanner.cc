@@ -0,0 +1,404 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <cctype>
+
+#include "internal/Scanner.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BSON_SCANNER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace bson {
+
+namespace internal {
+
+namespace {
+
+typedef const char *(*SkipFunc)(const char *, const char *);
+typedef const char *(*FindFunc)(const char *, const char *, char);
+typedef void (*ClassifyFunc)(const char *, BlockMasks *);
+
+const char *skipWhitespaceScalar(const char *p, const char *end) {
+  while (p < end && IsSpace(*p))
+    p++;
+  return p;
+}
+
+const char *findQuoteOrEscapeScalar(const char *p, const char *end,
+                                    char quote) {
+  while (p < end && *p != quote && *p != '\\')
+    p++;
+  return p;
+}
+
+void classifyBlockScalar(const char *p, BlockMasks *masks) {
+  uint64_t quote = 0, backslash = 0, op = 0, space = 0;
+  for (int i = 0; i < BLOCK_SIZE; i++) {
+    uint64_t bit = uint64_t(1) << i;
+    switch (p[i]) {
+      case '"':
+        quote |= bit;
+        break;
+      case '\\':
+        backslash |= bit;
+        break;
+      case '{':
+      case '}':
+      case '[':
+      case ']':
+      case ':':
+      case ',':
+        op |= bit;
+        break;
+      default:
+        if (IsSpace(p[i]))
+          space |= bit;
+    }
+  }
+  masks->quote = quote;
+  masks->backslash = backslash;
+  masks->op = op;
+  masks->space = space;
+}
+
+#ifdef BSON_SCANNER_X86
+
+// After subtracting '\t' and flipping the sign bit, the control characters
+// '\t'...'\r' become the smallest signed bytes, so that they can be matched
+// by a single signed comparison.
+const char kCtrlBias = '\t';
+const char kCtrlLimit = static_cast<char>(-128 + ('\r' - '\t') + 1);
+const char kSignBit = static_cast<char>(0x80);
+
+const char *skipWhitespaceSSE2(const char *p, const char *end) {
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i bias = _mm_set1_epi8(kCtrlBias);
+  const __m128i sign = _mm_set1_epi8(kSignBit);
+  const __m128i limit = _mm_set1_epi8(kCtrlLimit);
+
+  for (; end - p >= 16; p += 16) {
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    __m128i ctrl = _mm_xor_si128(_mm_sub_epi8(c, bias), sign);
+    __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(c, space),
+                              _mm_cmplt_epi8(ctrl, limit));
+    unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(ws)) & 0xFFFFu;
+    if (mask)
+      return p + __builtin_ctz(mask);
+  }
+  return skipWhitespaceScalar(p, end);
+}
+
+const char *findQuoteOrEscapeSSE2(const char *p, const char *end,
+                                  char quote) {
+  const __m128i q = _mm_set1_epi8(quote);
+  const __m128i bs = _mm_set1_epi8('\\');
+
+  for (; end - p >= 16; p += 16) {
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(c, q), _mm_cmpeq_epi8(c, bs));
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+    if (mask)
+      return p + __builtin_ctz(mask);
+  }
+  return findQuoteOrEscapeScalar(p, end, quote);
+}
+
+__attribute__((target("avx2"))) const char *skipWhitespaceAVX2(
+    const char *p, const char *end) {
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i bias = _mm256_set1_epi8(kCtrlBias);
+  const __m256i sign = _mm256_set1_epi8(kSignBit);
+  const __m256i limit = _mm256_set1_epi8(kCtrlLimit);
+
+  for (; end - p >= 32; p += 32) {
+    __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    __m256i ctrl = _mm256_xor_si256(_mm256_sub_epi8(c, bias), sign);
+    __m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(c, space),
+                                 _mm256_cmpgt_epi8(limit, ctrl));
+    unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(ws));
+    if (mask)
+      return p + __builtin_ctz(mask);
+  }
+  return skipWhitespaceSSE2(p, end);
+}
+
+__attribute__((target("avx2"))) const char *findQuoteOrEscapeAVX2(
+    const char *p, const char *end, char quote) {
+  const __m256i q = _mm256_set1_epi8(quote);
+  const __m256i bs = _mm256_set1_epi8('\\');
+
+  for (; end - p >= 32; p += 32) {
+    __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    __m256i hit =
+        _mm256_or_si256(_mm256_cmpeq_epi8(c, q), _mm256_cmpeq_epi8(c, bs));
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+    if (mask)
+      return p + __builtin_ctz(mask);
+  }
+  return findQuoteOrEscapeSSE2(p, end, quote);
+}
+
+void classifyBlockSSE2(const char *p, BlockMasks *masks) {
+  const __m128i bias = _mm_set1_epi8(kCtrlBias);
+  const __m128i sign = _mm_set1_epi8(kSignBit);
+  const __m128i limit = _mm_set1_epi8(kCtrlLimit);
+
+  uint64_t quote = 0, backslash = 0, op = 0, space = 0;
+  for (int i = 0; i < BLOCK_SIZE; i += 16) {
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+    __m128i ctrl = _mm_xor_si128(_mm_sub_epi8(c, bias), sign);
+    __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')),
+                              _mm_cmplt_epi8(ctrl, limit));
+    // '{' | 0x20 == '{' and '[' | 0x20 == '{', the same for the closings.
+    __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+    __m128i ops = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('{')),
+                     _mm_cmpeq_epi8(lower, _mm_set1_epi8('}'))),
+        _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(':')),
+                     _mm_cmpeq_epi8(c, _mm_set1_epi8(','))));
+
+    quote |= uint64_t(static_cast<uint16_t>(_mm_movemask_epi8(
+                 _mm_cmpeq_epi8(c, _mm_set1_epi8('"')))))
+             << i;
+    backslash |= uint64_t(static_cast<uint16_t>(_mm_movemask_epi8(
+                     _mm_cmpeq_epi8(c, _mm_set1_epi8('\\')))))
+                 << i;
+    op |= uint64_t(static_cast<uint16_t>(_mm_movemask_epi8(ops))) << i;
+    space |= uint64_t(static_cast<uint16_t>(_mm_movemask_epi8(ws))) << i;
+  }
+  masks->quote = quote;
+  masks->backslash = backslash;
+  masks->op = op;
+  masks->space = space;
+}
+
+__attribute__((target("avx2"))) void classifyBlockAVX2(const char *p,
+                                                       BlockMasks *masks) {
+  const __m256i bias = _mm256_set1_epi8(kCtrlBias);
+  const __m256i sign = _mm256_set1_epi8(kSignBit);
+  const __m256i limit = _mm256_set1_epi8(kCtrlLimit);
+
+  uint64_t quote = 0, backslash = 0, op = 0, space = 0;
+  for (int i = 0; i < BLOCK_SIZE; i += 32) {
+    __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+    __m256i ctrl = _mm256_xor_si256(_mm256_sub_epi8(c, bias), sign);
+    __m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(' ')),
+                                 _mm256_cmpgt_epi8(limit, ctrl));
+    __m256i lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+    __m256i ops = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('{')),
+                        _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('}'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(':')),
+                        _mm256_cmpeq_epi8(c, _mm256_set1_epi8(','))));
+
+    quote |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(
+                 _mm256_cmpeq_epi8(c, _mm256_set1_epi8('"')))))
+             << i;
+    backslash |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(
+                     _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\\')))))
+                 << i;
+    op |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(ops))) << i;
+    space |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(ws))) << i;
+  }
+  masks->quote = quote;
+  masks->backslash = backslash;
+  masks->op = op;
+  masks->space = space;
+}
+
+#endif  // BSON_SCANNER_X86
+
+const char *skipWhitespaceResolve(const char *p, const char *end);
+const char *findQuoteOrEscapeResolve(const char *p, const char *end,
+                                     char quote);
+void classifyBlockResolve(const char *p, BlockMasks *masks);
+
+// All of them point to the resolvers until the first call, which replaces
+// them with the best implementation available on this cpu.
+std::atomic<SkipFunc> skipWhitespaceImpl(skipWhitespaceResolve);
+std::atomic<FindFunc> findQuoteOrEscapeImpl(findQuoteOrEscapeResolve);
+std::atomic<ClassifyFunc> classifyBlockImpl(classifyBlockResolve);
+
+// Switch to the implementation "impl".
+// @return false if it isn't supported by this cpu, nothing is changed then.
+bool use(ScannerImpl_t impl) {
+  SkipFunc skip;
+  FindFunc find;
+  ClassifyFunc classify;
+  switch (impl) {
+    case kScalarScanner:
+      skip = skipWhitespaceScalar;
+      find = findQuoteOrEscapeScalar;
+      classify = classifyBlockScalar;
+      break;
+#ifdef BSON_SCANNER_X86
+    case kSSE2Scanner:
+      skip = skipWhitespaceSSE2;
+      find = findQuoteOrEscapeSSE2;
+      classify = classifyBlockSSE2;
+      break;
+    case kAVX2Scanner:
+      __builtin_cpu_init();
+      if (!__builtin_cpu_supports("avx2"))
+        return false;
+      skip = skipWhitespaceAVX2;
+      find = findQuoteOrEscapeAVX2;
+      classify = classifyBlockAVX2;
+      break;
+#endif
+    default:
+      return false;
+  }
+  skipWhitespaceImpl.store(skip, std::memory_order_relaxed);
+  findQuoteOrEscapeImpl.store(find, std::memory_order_relaxed);
+  classifyBlockImpl.store(classify, std::memory_order_relaxed);
+  return true;
+}
+
+void resolve() {
+  use(kAVX2Scanner) || use(kSSE2Scanner) || use(kScalarScanner);
+}
+
+const char *skipWhitespaceResolve(const char *p, const char *end) {
+  resolve();
+  return skipWhitespaceImpl.load(std::memory_order_relaxed)(p, end);
+}
+
+const char *findQuoteOrEscapeResolve(const char *p, const char *end,
+                                     char quote) {
+  resolve();
+  return findQuoteOrEscapeImpl.load(std::memory_order_relaxed)(p, end, quote);
+}
+
+void classifyBlockResolve(const char *p, BlockMasks *masks) {
+  resolve();
+  classifyBlockImpl.load(std::memory_order_relaxed)(p, masks);
+}
+
+// Parses the 4 hex digits of "\uXXXX" beginning at "p".
+// @return false if "p" doesn't begin such a sequence before "end".
+bool parseHex4(const char *p, const char *end, uint32_t *code) {
+  if (end - p < 6 || p[0] != '\\' || p[1] != 'u')
+    return false;
+
+  uint32_t c = 0;
+  for (int i = 2; i < 6; i++) {
+    char h = p[i];
+    c <<= 4;
+    if (h >= '0' && h <= '9')
+      c |= static_cast<uint32_t>(h - '0');
+    else if (h >= 'a' && h <= 'f')
+      c |= static_cast<uint32_t>(h - 'a' + 10);
+    else if (h >= 'A' && h <= 'F')
+      c |= static_cast<uint32_t>(h - 'A' + 10);
+    else
+      return false;
+  }
+  *code = c;
+  return true;
+}
+
+}  // namespace
+
+const char *SkipWhitespaceSlow(const char *p, const char *end) {
+  return skipWhitespaceImpl.load(std::memory_order_relaxed)(p, end);
+}
+
+const char *FindQuoteOrEscape(const char *p, const char *end, char quote) {
+  return findQuoteOrEscapeImpl.load(std::memory_order_relaxed)(p, end, quote);
+}
+
+void ClassifyBlock(const char *p, BlockMasks *masks) {
+  classifyBlockImpl.load(std::memory_order_relaxed)(p, masks);
+}
+
+bool IsEscapePrefix(const char *p, const char *end) {
+  if (end - p >= kMaxEscapeSize)
+    return false;
+  for (int i = 0; p + i < end; i++) {
+    char c = p[i];
+    bool ok;
+    switch (i % 6) {
+      case 0:
+        ok = (c == '\\');
+        break;
+      case 1:
+        ok = (c == 'u');
+        break;
+      default:
+        ok = isxdigit(static_cast<unsigned char>(c)) != 0;
+        break;
+    }
+    if (!ok)
+      return false;
+  }
+  return true;
+}
+
+bool TEST_UseScanner(ScannerImpl_t impl) {
+  if (impl == kBestScanner) {
+    resolve();
+    return true;
+  }
+  return use(impl);
+}
+
+const char *DecodeUnicodeEscape(const char *p, const char *end, char *utf8,
+                                size_t *len) {
+  uint32_t c;
+  if (!parseHex4(p, end, &c))
+    return nullptr;
+  p += 6;
+
+  if (c >= 0xDC00 && c <= 0xDFFF)
+    return nullptr;  // lone low surrogate
+  if (c >= 0xD800 && c <= 0xDBFF) {
+    uint32_t low;
+    if (!parseHex4(p, end, &low) || low < 0xDC00 || low > 0xDFFF)
+      return nullptr;
+    p += 6;
+    c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+  }
+
+  if (c < 0x80) {
+    utf8[0] = static_cast<char>(c);
+    *len = 1;
+  } else if (c < 0x800) {
+    utf8[0] = static_cast<char>(0xC0 | (c >> 6));
+    utf8[1] = static_cast<char>(0x80 | (c & 0x3F));
+    *len = 2;
+  } else if (c < 0x10000) {
+    utf8[0] = static_cast<char>(0xE0 | (c >> 12));
+    utf8[1] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+    utf8[2] = static_cast<char>(0x80 | (c & 0x3F));
+    *len = 3;
+  } else {
+    utf8[0] = static_cast<char>(0xF0 | (c >> 18));
+    utf8[1] = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+    utf8[2] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+    utf8[3] = static_cast<char>(0x80 | (c & 0x3F));
+    *len = 4;
+  }
+  return p;
+}
+
+}  // namespace internal
+
+}  // namespace bson
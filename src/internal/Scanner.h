@@ -0,0 +1,173 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Slice.h"
+
+namespace bson {
+
+namespace internal {
+
+// Character scanning primitives used by the json Parser. Each of them
+// examines the input 16 (SSE2) or 32 (AVX2) bytes at a time when the cpu
+// supports it, the best implementation is chosen at runtime on first use,
+// with a portable scalar fallback.
+
+// Implementations of the primitives, from the slowest.
+enum ScannerImpl_t {
+  kScalarScanner = 0,
+  kSSE2Scanner = 1,
+  kAVX2Scanner = 2,
+  kBestScanner = 3,  // the best one this cpu supports
+};
+
+// (TEST) Make all the primitives use "impl" from now on.
+// @return false if this cpu doesn't support it, nothing is changed then.
+bool TEST_UseScanner(ScannerImpl_t impl);
+
+// Same set of characters as isspace() in the "C" locale.
+inline bool IsSpace(char c) {
+  return c == ' ' || static_cast<unsigned char>(c - '\t') <= '\r' - '\t';
+}
+
+// @return the first position in [p, end) which is not a whitespace, or "end"
+// if there's none.
+const char *SkipWhitespaceSlow(const char *p, const char *end);
+
+inline const char *SkipWhitespace(const char *p, const char *end) {
+  // Fast path for compact json, where tokens are seldom separated by spaces.
+  if (p < end && !IsSpace(*p))
+    return p;
+  return SkipWhitespaceSlow(p, end);
+}
+
+// Decodes the two-character escape sequence "\c" defined in ECMA-404
+// (http://www.ecma-international.org/publications/files/ECMA-ST/ECMA-404.pdf).
+// By default the unescaped character is passed on (e.g \q to q).
+// NOTE: "\u" sequences are left to the caller, @see DecodeUnicodeEscape.
+inline char Unescape(char c) {
+  switch (c) {
+    case 'b':
+      return '\b';
+    case 'f':
+      return '\f';
+    case 'n':
+      return '\n';
+    case 'r':
+      return '\r';
+    case 't':
+      return '\t';
+    default:
+      return c;
+  }
+}
+
+// Decodes the escape sequence "\uXXXX" beginning at "p", or the surrogate pair
+// "\uXXXX\uXXXX", into at most 4 bytes of UTF-8 stored to "utf8".
+// @return the position right after the sequence, along with the number of
+// bytes stored to "len", or nullptr if the sequence is malformed, is a lone
+// surrogate, or isn't complete before "end".
+const char *DecodeUnicodeEscape(const char *p, const char *end, char *utf8,
+                                size_t *len);
+
+// @return the first position in [p, end) which holds either "quote" or a
+// backslash, or "end" if there's none.
+const char *FindQuoteOrEscape(const char *p, const char *end, char quote);
+
+// The longest escape sequence, a surrogate pair "\uXXXX\uXXXX".
+enum { kMaxEscapeSize = 12 };
+
+// @return whether [p, end) may be the beginning of a "\u" escape sequence cut
+// by "end", i.e it's shorter than kMaxEscapeSize and matches the beginning of
+// "\uXXXX\uXXXX".
+bool IsEscapePrefix(const char *p, const char *end);
+
+// Decodes the quoted string whose content begins at "p", up to the closing
+// "quote", from input which may be cut by "end", e.g a chunk of a stream.
+// The decoded content is passed to "append" piece by piece, each piece is a
+// Slice of either the input or an unescaped character.
+// @return the position right after the closing quote. Otherwise nullptr, and
+// the position where decoding stopped is stored to "stop": either "end", or
+// the backslash of an escape sequence which may be cut by "end", or nullptr
+// if an escape sequence is malformed.
+template <class AppendFunc>
+const char *DecodeQuotedPrefix(const char *p, const char *end, char quote,
+                               AppendFunc append, const char **stop) {
+  while (true) {
+    const char *q = FindQuoteOrEscape(p, end, quote);
+    if (q > p)
+      append(Slice(p, static_cast<size_t>(q - p)));
+    if (q == end) {
+      *stop = end;
+      return nullptr;
+    }
+    if (*q == quote)
+      return q + 1;
+    if (q + 1 == end) {
+      *stop = q;
+      return nullptr;
+    }
+
+    if (q[1] == 'u') {
+      char utf8[4];
+      size_t len;
+      p = DecodeUnicodeEscape(q, end, utf8, &len);
+      if (p == nullptr) {
+        *stop = IsEscapePrefix(q, end) ? q : nullptr;
+        return nullptr;
+      }
+      append(Slice(utf8, len));
+    } else {
+      char c = Unescape(q[1]);
+      append(Slice(&c, 1));
+      p = q + 2;
+    }
+  }
+}
+
+// Decodes the quoted string whose content begins at "p", up to the closing
+// "quote", @see DecodeQuotedPrefix.
+// @return the position right after the closing quote, or nullptr if the string
+// isn't terminated before "end" or holds a malformed "\u" escape sequence.
+template <class AppendFunc>
+const char *DecodeQuoted(const char *p, const char *end, char quote,
+                         AppendFunc append) {
+  const char *stop;
+  return DecodeQuotedPrefix(p, end, quote, append, &stop);
+}
+
+// Bitmaps of the character classes in a block of 64 bytes, bit i stands for
+// the i-th byte of the block.
+struct BlockMasks {
+  uint64_t quote;      // '"'
+  uint64_t backslash;  // '\\'
+  uint64_t op;         // one of "{}[]:,"
+  uint64_t space;      // IsSpace()
+};
+
+enum { BLOCK_SIZE = 64 };
+
+// Classifies the BLOCK_SIZE bytes starting at "p".
+void ClassifyBlock(const char *p, BlockMasks *masks);
+
+}  // namespace internal
+
+}  // namespace bson
@@ -0,0 +1,136 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "internal/Scanner.h"
+#include "internal/StructuralIndex.h"
+
+namespace bson {
+
+namespace internal {
+
+namespace {
+
+const uint64_t kEvenBits = 0x5555555555555555ULL;
+const uint64_t kOddBits = ~kEvenBits;
+
+// @return the bitmap of characters that are escaped, namely those preceded by
+// an odd-length sequence of backslashes.
+// "prevEndsOddBackslash" carries (1 or 0) whether the previous block ended
+// with an odd-length sequence of backslashes.
+uint64_t findEscaped(uint64_t backslash, uint64_t *prevEndsOddBackslash) {
+  uint64_t startEdges = backslash & ~(backslash << 1);
+
+  // A sequence continued from the previous block has its parity flipped.
+  uint64_t evenStartMask = kEvenBits ^ *prevEndsOddBackslash;
+  uint64_t evenStarts = startEdges & evenStartMask;
+  uint64_t oddStarts = startEdges & ~evenStartMask;
+
+  // Adding the start of a sequence to the sequence itself carries the bit
+  // past its end.
+  uint64_t evenCarries = backslash + evenStarts;
+  uint64_t oddCarries = backslash + oddStarts;
+  bool endsOddBackslash = oddCarries < backslash;  // overflowed
+  oddCarries |= *prevEndsOddBackslash;
+  *prevEndsOddBackslash = endsOddBackslash ? 1 : 0;
+
+  uint64_t evenCarryEnds = evenCarries & ~backslash;
+  uint64_t oddCarryEnds = oddCarries & ~backslash;
+  return (evenCarryEnds & kOddBits) | (oddCarryEnds & kEvenBits);
+}
+
+// Bit i of the result is the xor of bits [0, i] of "x".
+inline uint64_t prefixXor(uint64_t x) {
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+}  // namespace
+
+Status StructuralIndex::Build(Slice json) {
+  const char *buf = json.RawData();
+  const size_t len = json.Len();
+
+  if (len >= std::numeric_limits<uint32_t>::max())
+    return Status::FailedToParse("Input is too large to be indexed");
+
+  uint64_t prevEndsOddBackslash = 0;
+  uint64_t prevInString = 0;        // all ones iff a string spans the blocks
+  uint64_t prevEndsPseudoPred = 1;  // the beginning of input precedes a token
+
+  size_t count = 0;
+  char tail[BLOCK_SIZE];
+
+  for (size_t base = 0; base < len; base += BLOCK_SIZE) {
+    const char *block = buf + base;
+    if (len - base < BLOCK_SIZE) {
+      // Pad the last block with spaces, which are never indexed.
+      memset(tail, ' ', BLOCK_SIZE);
+      memcpy(tail, block, len - base);
+      block = tail;
+    }
+
+    BlockMasks m;
+    ClassifyBlock(block, &m);
+
+    uint64_t quotes = m.quote & ~findEscaped(m.backslash, &prevEndsOddBackslash);
+
+    // Bits from an opening quote up to but excluding the closing quote.
+    uint64_t inString = prefixXor(quotes) ^ prevInString;
+    prevInString =
+        static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+
+    uint64_t structurals = (m.op & ~inString) | quotes;
+
+    // Scalar tokens begin right after a structural character or a whitespace.
+    uint64_t pseudoPred = structurals | m.space;
+    uint64_t pseudoStructurals =
+        ((pseudoPred << 1) | prevEndsPseudoPred) & ~m.space & ~inString;
+    prevEndsPseudoPred = pseudoPred >> 63;
+    structurals |= pseudoStructurals;
+
+    // Closing quotes are not needed by the second stage.
+    structurals &= ~(quotes & ~inString);
+
+    if (count + BLOCK_SIZE > positions_.size()) {
+      positions_.resize(std::max(positions_.size() * 2, count + BLOCK_SIZE));
+    }
+    uint32_t *out = positions_.data() + count;
+    while (structurals) {
+      *out++ = static_cast<uint32_t>(base + __builtin_ctzll(structurals));
+      structurals &= structurals - 1;
+    }
+    count = static_cast<size_t>(out - positions_.data());
+  }
+  positions_.resize(count);
+
+  if (prevInString)
+    return Status::FailedToParse("Unterminated string");
+  return Status::OK();
+}
+
+}  // namespace internal
+
+}  // namespace bson
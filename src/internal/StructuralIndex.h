@@ -0,0 +1,70 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "DisallowCopying.h"
+#include "Slice.h"
+#include "Status.h"
+
+namespace bson {
+
+namespace internal {
+
+// StructuralIndex is the first stage of StructuralParser. It classifies the
+// json input 64 bytes at a time with SIMD (@see Scanner.h) and records the
+// offset of every structural character outside of strings ("{}[]:,"), every
+// opening quote, and the first character of every other scalar token (numbers
+// and literals like true, false, null).
+//
+// Escaped quotes are detected with the carry-propagation technique described
+// in "Parsing Gigabytes of JSON per Second" (Langdale & Lemire), and the
+// in-string mask is computed as a prefix xor of the unescaped quotes.
+//
+class StructuralIndex {
+  __DISALLOW_COPYING__(StructuralIndex);
+
+ public:
+  StructuralIndex() = default;
+
+  // Indexes "json", the previous results are discarded.
+  // @return FailedToParse if a string is not terminated, or if the input is
+  // too large to be addressed by 32-bit offsets.
+  Status Build(Slice json);
+
+  const uint32_t *begin() const {
+    return positions_.data();
+  }
+
+  const uint32_t *end() const {
+    return positions_.data() + positions_.size();
+  }
+
+  size_t Size() const {
+    return positions_.size();
+  }
+
+ private:
+  std::vector<uint32_t> positions_;
+};
+
+}  // namespace internal
+
+}  // namespace bson
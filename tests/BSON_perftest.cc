@@ -21,6 +21,8 @@
  */
 
 #include <fstream>
+#include <memory>
+#include <vector>
 #include <benchmark/benchmark.h>
 #include <glog/logging.h>
 #include <silly/Slice.h>
@@ -31,6 +33,9 @@
 #include <rapidjson/writer.h>
 
 #include "BSON.h"
+#include "BatchParser.h"
+#include "ObjectBuilder.h"
+#include "Validate.h"
 
 std::string json_files[6] = {
     "../../data/canada.json",  "../../data/mock.json",
@@ -38,8 +43,8 @@ std::string json_files[6] = {
     "../../data/default.json", "../../data/anyOf.json",
 };
 
-uint64_t bytesCount[3];
-int64_t totalTime[3];
+uint64_t bytesCount[5];
+int64_t totalTime[5];
 
 template <class F, int testCnt> void JSON_Benchmark(benchmark::State& state) {
   typedef std::istreambuf_iterator<char> iterator_t;
@@ -80,6 +85,20 @@ struct BSONCpp11 {
   }
 };
 
+struct BSONCpp11Structural {
+  void operator()(const silly::Slice& s) {
+    bson::FromJSON(s, bson::kStructuralIndex);
+  }
+};
+
+// Round trip json -> bson -> json, to be compared with RapidJSON, which
+// writes the parsed document back with its Writer as well.
+struct BSONCpp11RoundTrip {
+  void operator()(const silly::Slice& s) {
+    bson::ToJSON(bson::FromJSON(s));
+  }
+};
+
 BENCHMARK_TEMPLATE2(JSON_Benchmark, StrDup, 0)
     ->Arg(0)
     ->Arg(1)
@@ -104,6 +123,203 @@ BENCHMARK_TEMPLATE2(JSON_Benchmark, BSONCpp11, 2)
     ->Arg(4)
     ->Arg(5);
 
+BENCHMARK_TEMPLATE2(JSON_Benchmark, BSONCpp11Structural, 3)
+    ->Arg(0)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(3)
+    ->Arg(4)
+    ->Arg(5);
+
+BENCHMARK_TEMPLATE2(JSON_Benchmark, BSONCpp11RoundTrip, 4)
+    ->Arg(0)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(3)
+    ->Arg(4)
+    ->Arg(5);
+
+// Renders each element of the root array of data/mock.json as a line.
+// @param lines receives the offset and length of every line.
+std::string MockNDJSON(std::vector<std::pair<size_t, size_t>>* lines) {
+  typedef std::istreambuf_iterator<char> iterator_t;
+  std::ifstream ifs(json_files[1]);
+  std::string json(iterator_t(ifs), (iterator_t()));
+
+  bson::Object root = bson::FromJSON(json);
+  std::string ndjson;
+  for (const bson::Element& e : root) {
+    bson::Object record(bson::SharedBuffer(root.ShareFromThis(), e.RawValue()));
+    std::string line = bson::ToJSON(record);
+    if (lines)
+      lines->emplace_back(ndjson.size(), line.size());
+    ndjson += line + "\n";
+  }
+  return ndjson;
+}
+
+// Records per second on a newline-delimited version of data/mock.json, with
+// BatchParser (0) or with one FromJSON call per line (1).
+void NDJSON_Benchmark(benchmark::State& state) {
+  std::vector<std::pair<size_t, size_t>> lines;
+  std::string ndjson = MockNDJSON(&lines);
+
+  size_t records = 0;
+  while (state.KeepRunning()) {
+    if (state.range_x() == 0) {
+      bson::BatchParser parser;
+      records += parser.Parse(
+          ndjson, [](size_t, const bson::Status&, const bson::Object*) {});
+    } else {
+      for (auto& l : lines)
+        bson::FromJSON(silly::Slice(ndjson.data() + l.first, l.second));
+      records += lines.size();
+    }
+  }
+  state.SetItemsProcessed(records);
+  state.SetBytesProcessed(state.iterations() * ndjson.size());
+}
+
+BENCHMARK(NDJSON_Benchmark)->Arg(0)->Arg(1);
+
+// Scaling of BatchParser::ParseParallel with the number of threads, on 16
+// copies of the NDJSON above.
+void NDJSON_Parallel_Benchmark(benchmark::State& state) {
+  std::vector<std::pair<size_t, size_t>> lines;
+  std::string ndjson = MockNDJSON(&lines);
+  std::string input;
+  for (int i = 0; i < 16; i++)
+    input += ndjson;
+
+  size_t records = 0;
+  while (state.KeepRunning()) {
+    bson::BatchParser parser;
+    records += parser.ParseParallel(input, state.range_x()).size();
+  }
+  state.SetItemsProcessed(records);
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+
+BENCHMARK(NDJSON_Parallel_Benchmark)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Arg(16)
+    ->Arg(32)
+    ->UseRealTime();
+
+// Cost of looking up every field of an object with range_x fields, with a
+// linear scan (range_y == 0) or through the field index (range_y == 1).
+void FieldLookup_Benchmark(benchmark::State& state) {
+  int fields = state.range_x();
+  std::vector<std::string> names;
+  bson::ObjectBuilder builder;
+  for (int i = 0; i < fields; i++) {
+    names.push_back("field_" + std::to_string(i));
+    builder.Append(names.back(), i);
+  }
+  bson::Object obj = builder.Done(state.range_y() == 1);
+
+  long long sum = 0;
+  while (state.KeepRunning()) {
+    for (const std::string& name : names)
+      sum += obj[name].ValueOf<int>();
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations() * fields);
+}
+
+BENCHMARK(FieldLookup_Benchmark)
+    ->ArgPair(8, 0)
+    ->ArgPair(8, 1)
+    ->ArgPair(32, 0)
+    ->ArgPair(32, 1)
+    ->ArgPair(256, 0)
+    ->ArgPair(256, 1)
+    ->ArgPair(1024, 0)
+    ->ArgPair(1024, 1);
+
+// Elements per second of a full recursive iteration over the objects parsed
+// from json_files[range_x].
+void Iterate_Benchmark(benchmark::State& state) {
+  typedef std::istreambuf_iterator<char> iterator_t;
+  std::ifstream ifs(json_files[state.range_x()]);
+  std::string json(iterator_t(ifs), (iterator_t()));
+  bson::Object obj = bson::FromJSON(json);
+
+  size_t elements = 0;
+  std::vector<bson::ObjectView> pending;
+  while (state.KeepRunning()) {
+    pending.push_back(obj);
+    while (!pending.empty()) {
+      bson::ObjectView cur = pending.back();
+      pending.pop_back();
+      for (const bson::Element& e : cur) {
+        elements++;
+        if (e.Type() == bson::kObject || e.Type() == bson::kArray)
+          pending.push_back(e.ValueOf<bson::ObjectView>());
+      }
+    }
+  }
+  state.SetItemsProcessed(elements);
+  state.SetBytesProcessed(state.iterations() * obj.TotalSize());
+}
+
+BENCHMARK(Iterate_Benchmark)->Arg(0)->Arg(1)->Arg(2);
+
+// Bytes per second of validating the objects parsed from json_files[range_x]
+// (range_y == 0), against copying them with memcpy (range_y == 1).
+void Validate_Benchmark(benchmark::State& state) {
+  typedef std::istreambuf_iterator<char> iterator_t;
+  std::ifstream ifs(json_files[state.range_x()]);
+  std::string json(iterator_t(ifs), (iterator_t()));
+  bson::Object obj = bson::FromJSON(json);
+  std::string copy(obj.TotalSize(), '\0');
+
+  while (state.KeepRunning()) {
+    if (state.range_y() == 0) {
+      bson::Status s = bson::Validate(obj.RawData(), obj.TotalSize());
+      benchmark::DoNotOptimize(s);
+    } else {
+      memcpy(&copy[0], obj.RawData(), obj.TotalSize());
+      benchmark::DoNotOptimize(copy.data());
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * obj.TotalSize());
+}
+
+BENCHMARK(Validate_Benchmark)
+    ->ArgPair(0, 0)
+    ->ArgPair(0, 1)
+    ->ArgPair(1, 0)
+    ->ArgPair(1, 1)
+    ->ArgPair(2, 0)
+    ->ArgPair(2, 1);
+
+// Cost of building objects of range_x fields, with a default ObjectBuilder
+// (range_y == 0) or one sized by a SizeHint (range_y == 1).
+void Build_Benchmark(benchmark::State& state) {
+  int fields = state.range_x();
+  bson::SizeHint hint;
+  while (state.KeepRunning()) {
+    std::unique_ptr<bson::ObjectBuilder> builder(
+        state.range_y() == 1 ? new bson::ObjectBuilder(&hint)
+                             : new bson::ObjectBuilder);
+    for (int i = 0; i < fields; i++)
+      builder->Append("field", i);
+    bson::Object obj = builder->Done();
+    benchmark::DoNotOptimize(obj.RawData());
+  }
+  state.SetItemsProcessed(state.iterations() * fields);
+}
+
+BENCHMARK(Build_Benchmark)
+    ->ArgPair(4, 0)
+    ->ArgPair(4, 1)
+    ->ArgPair(1024, 0)
+    ->ArgPair(1024, 1);
+
 int main(int argc, const char** argv) {
   ::benchmark::Initialize(&argc, argv);
   ::benchmark::RunSpecifiedBenchmarks();
@@ -115,4 +331,10 @@ int main(int argc, const char** argv) {
 
   fprintf(stderr, "The bson-cpp rate is at %lf kb/s\n",
           (double)(bytesCount[2]) / (totalTime[2] / 1000000000));
+
+  fprintf(stderr, "The bson-cpp (structural index) rate is at %lf kb/s\n",
+          (double)(bytesCount[3]) / (totalTime[3] / 1000000000));
+
+  fprintf(stderr, "The bson-cpp round trip rate is at %lf kb/s\n",
+          (double)(bytesCount[4]) / (totalTime[4] / 1000000000));
 }
\ No newline at end of file
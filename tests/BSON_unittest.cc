@@ -17,9 +17,24 @@
 
 #include <gtest/gtest.h>
 #include <glog/logging.h>
+#include <cmath>
+#include <cstdio>
 #include <fstream>
+#include <limits>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <unistd.h>
 
+#include "BSONFileReader.h"
+#include "BSONFileWriter.h"
+#include "BatchParser.h"
+#include "FieldPath.h"
+#include "IncrementalParser.h"
 #include "Parser.h"
+#include "StructuralParser.h"
+#include "Validate.h"
+#include "ValueTypes.h"
 #include "BSON.h"
 
 using namespace bson;
@@ -132,4 +147,841 @@ TEST(Parser, TypeJson) {
 
   ASSERT_TRUE(obj.begin() != obj.end());
   LOG(INFO) << obj.Dump();
-}
\ No newline at end of file
+}
+TEST(StructuralParser, Basic) {
+  ObjectBuilder builder;
+  StructuralParser parser(
+      "{"
+      "\"1\" : 2147483647, "
+      "\"2\" : -2147483648, "
+      "\"3\" : -9223372036854775808, "
+      "\"4\" : 9223372036854775807, "
+      "\"5\" : 1.79769e+30, "
+      "\"6\" : 2.22507e-30,"
+      "\"7\" : true,"
+      "\"8\" : false,"
+      "\"9\" : null,"
+      "\"10\" : \"sunshine \\\"boys\\\"\","
+      "\"11\" : {\"x\" : [1, [], {}]}"
+      "}");
+
+  Status r = parser.Parse(builder);
+  ASSERT_TRUE(r.IsOK()) << r.ToString();
+
+  Object obj = builder.Obj();
+  ASSERT_EQ(obj.NumFields(), 11);
+  ASSERT_EQ(obj.find("1")->Type(), kNumberInt);
+  ASSERT_EQ(obj.find("4")->Type(), kNumberLong);
+  ASSERT_EQ(obj.find("5")->Type(), kNumberDouble);
+  ASSERT_EQ(obj.find("10")->ValueOf<Slice>().ToString(),
+            "sunshine \"boys\"");
+  ASSERT_EQ(obj.find("11")->Type(), kObject);
+  LOG(INFO) << "TEST StructuralParser Basic: " << obj.Dump() << std::endl;
+}
+
+TEST(StructuralParser, Invalid) {
+  const char *inputs[] = {"",       "1",        "{",         "[1,]",
+                          "[1 2]",  "{\"a\" 1}", "{\"a\":}",   "{\"a\":1,}",
+                          "[tru]",  "[\"a]",     "{\"a\":1}}", "{'a':1}"};
+  for (const char *json : inputs) {
+    ObjectBuilder builder;
+    StructuralParser parser(json);
+    ASSERT_TRUE(parser.Parse(builder).IsFailedToParse()) << json;
+  }
+}
+
+// Both engines must produce exactly the same bson.
+TEST(StructuralParser, SameAsParser) {
+  const char *files[] = {"../../data/canada.json", "../../data/mock.json",
+                         "../../data/type.json",   "../../data/allOf.json",
+                         "../../data/default.json", "../../data/anyOf.json"};
+  typedef std::istreambuf_iterator<char> iterator_t;
+
+  for (const char *file : files) {
+    std::ifstream ifs(file);
+    std::string json(iterator_t(ifs), (iterator_t()));
+    ASSERT_FALSE(json.empty()) << file;
+
+    Object expected = FromJSON(json, kRecursiveDescent);
+    Object actual = FromJSON(json, kStructuralIndex);
+    ASSERT_EQ(std::string(expected.RawData(), expected.TotalSize()),
+              std::string(actual.RawData(), actual.TotalSize()))
+        << file;
+  }
+}
+
+TEST(Parser, Arena) {
+  std::ifstream ifs("../../data/mock.json");
+  typedef std::istreambuf_iterator<char> iterator_t;
+  std::string json(iterator_t(ifs), (iterator_t()));
+  ASSERT_FALSE(json.empty());
+
+  Arena arena;
+  Object expected = FromJSON(json);
+  Object actual = FromJSON(json, &arena);
+  ASSERT_EQ(std::string(expected.RawData(), expected.TotalSize()),
+            std::string(actual.RawData(), actual.TotalSize()));
+  ASSERT_GE(arena.BytesAllocated(), actual.TotalSize());
+}
+
+TEST(Parser, RecycledBuffers) {
+  // On a thread of its own, so that the objects parsed by the other tests
+  // don't affect its pool and size hint.
+  std::thread([] {
+    std::string json = "{\"s\" : \"" + std::string(1000, 'x') + "\"}";
+    const char *data;
+    {
+      Object obj = FromJSON(json);
+      data = obj.RawData();
+    }
+
+    // The buffer of the last object went back to the pool of this thread.
+    ASSERT_EQ(FromJSON(json).RawData(), data);
+
+    // Objects released by another thread go to the pool of that thread.
+    Object *obj = new Object(FromJSON(json));
+    size_t numFree = BufferPool::Local()->NumFreeBuffers();
+    std::thread([obj] { delete obj; }).join();
+    ASSERT_EQ(BufferPool::Local()->NumFreeBuffers(), numFree);
+    ASSERT_EQ(FromJSON(json)["s"].ValueOf<Slice>().Len(), 1000);
+
+    // Small objects parsed after a large one aren't left in its buffer.
+    std::string large = "{\"s\" : \"" + std::string(100000, 'x') + "\"}";
+    {
+      Object obj = FromJSON(large);
+      data = obj.RawData();
+    }
+    Object small = FromJSON(json);
+    ASSERT_NE(small.RawData(), data);
+    ASSERT_EQ(small["s"].ValueOf<Slice>().Len(), 1000);
+  }).join();
+}
+
+TEST(Parser, ArrayKeys) {
+  std::string json = "{\"a\" : [[], {\"b\" : [true]}";
+  for (int i = 2; i < 10050; i++)
+    json += ", " + std::to_string(i);
+  json += "]}";
+
+  std::vector<Object> objects;
+  IncrementalParser incremental;
+  ASSERT_TRUE(incremental.Feed(json, &objects).IsOK());
+  objects.push_back(FromJSON(json, kRecursiveDescent));
+  objects.push_back(FromJSON(json, kStructuralIndex));
+
+  for (const Object &obj : objects) {
+    ObjectView a = obj["a"].ValueOf<ObjectView>();
+    int i = 0;
+    for (const Element &e : a) {
+      ASSERT_EQ(std::string(e.RawFieldName()), std::to_string(i));
+      i++;
+    }
+    ASSERT_EQ(i, 10050);
+    ASSERT_STREQ(a["1"].ValueOf<ObjectView>()["b"]
+                     .ValueOf<ObjectView>()
+                     .begin()
+                     ->RawFieldName(),
+                 "0");
+  }
+}
+
+TEST(Parser, EscapedStrings) {
+  const char *json =
+      "{\"plain\" : \"abc\", \"esc\\\"aped\" : \"a\\tb\\\\c\\\"\", "
+      "\"sub\\n\" : {\"x\\/\" : \"\\/\"}}";
+
+  for (ParserEngine_t engine : {kRecursiveDescent, kStructuralIndex}) {
+    Object obj = FromJSON(json, engine);
+    ASSERT_EQ(obj.NumFields(), 3);
+    ASSERT_EQ(obj.find("plain")->ValueOf<Slice>().ToString(), "abc");
+    ASSERT_EQ(obj.find("esc\"aped")->ValueOf<Slice>().ToString(),
+              "a\tb\\c\"");
+    ASSERT_TRUE(obj.HasMember("sub\n"));
+  }
+}
+
+TEST(Parser, UnicodeEscapes) {
+  const char *json =
+      "{\"caf\\u00e9\" : \"\\u20ac \\ud83d\\ude00\", \"a\" : [\"\\u0041\"]}";
+  for (ParserEngine_t engine : {kRecursiveDescent, kStructuralIndex}) {
+    Object obj = FromJSON(json, engine);
+    ASSERT_EQ(obj.find("caf\xc3\xa9")->ValueOf<Slice>().ToString(),
+              "\xe2\x82\xac \xf0\x9f\x98\x80");
+    ASSERT_EQ(
+        obj["a"].ValueOf<ObjectView>()["0"].ValueOf<Slice>().ToString(), "A");
+  }
+
+  const char *invalid[] = {"{\"a\" : \"\\u12\"}", "{\"a\" : \"\\ud800\"}",
+                           "{\"\\uzzzz\" : 1}"};
+  for (const char *json : invalid) {
+    ObjectBuilder builder;
+    Parser parser(json);
+    ASSERT_TRUE(parser.Parse(builder).IsFailedToParse()) << json;
+
+    ObjectBuilder other;
+    StructuralParser structural(json);
+    ASSERT_TRUE(structural.Parse(other).IsFailedToParse()) << json;
+  }
+}
+
+TEST(ToJSON, Basic) {
+  Object obj = FromJSON(
+      "{\"i\" : 1, \"l\" : -9223372036854775808, \"d\" : 0.1, \"e\" : 1e300, "
+      "\"s\" : \"a\\\"b\\\\c\\n\", \"t\" : true, \"f\" : false, \"n\" : null, "
+      "\"o\" : {\"a\" : [1, 2.0, {}], \"b\" : []}, \"x\" : Infinity}");
+
+  ASSERT_EQ(ToJSON(obj),
+            "{\"i\":1,\"l\":-9223372036854775808,\"d\":0.1,\"e\":1e300,"
+            "\"s\":\"a\\\"b\\\\c\\n\",\"t\":true,\"f\":false,\"n\":null,"
+            "\"o\":{\"a\":[1,2.0,{}],\"b\":[]},\"x\":Infinity}");
+
+  ASSERT_EQ(ToJSON(FromJSON("{\"o\" : {\"a\" : [1, {}]}, \"b\" : []}"),
+                   kPretty),
+            "{\n"
+            "  \"o\": {\n"
+            "    \"a\": [\n"
+            "      1,\n"
+            "      {}\n"
+            "    ]\n"
+            "  },\n"
+            "  \"b\": []\n"
+            "}");
+
+  ASSERT_EQ(ToJSON(FromJSON("{}")), "{}");
+  ASSERT_EQ(ToJSON(FromJSON("{}"), kPretty), "{}");
+
+  // Non-finite doubles are read back by all the parsers.
+  ObjectBuilder builder;
+  builder.Append("inf", std::numeric_limits<double>::infinity())
+      .Append("-inf", -std::numeric_limits<double>::infinity())
+      .Append("nan", std::numeric_limits<double>::quiet_NaN());
+  std::string json = ToJSON(builder.Done());
+  ASSERT_EQ(json, "{\"inf\":Infinity,\"-inf\":-Infinity,\"nan\":NaN}");
+
+  std::vector<Object> objects;
+  IncrementalParser incremental;
+  ASSERT_TRUE(incremental.Feed(json, &objects).IsOK());
+  objects.push_back(FromJSON(json, kRecursiveDescent));
+  objects.push_back(FromJSON(json, kStructuralIndex));
+  for (const Object &obj : objects) {
+    ASSERT_EQ(obj["inf"].ValueOf<double>(),
+              std::numeric_limits<double>::infinity());
+    ASSERT_EQ(obj["-inf"].ValueOf<double>(),
+              -std::numeric_limits<double>::infinity());
+    ASSERT_TRUE(std::isnan(obj["nan"].ValueOf<double>()));
+  }
+}
+
+TEST(ToJSON, RoundTrip) {
+  const char *files[] = {"../../data/canada.json", "../../data/mock.json",
+                         "../../data/type.json",   "../../data/allOf.json",
+                         "../../data/default.json", "../../data/anyOf.json"};
+  typedef std::istreambuf_iterator<char> iterator_t;
+
+  for (const char *file : files) {
+    std::ifstream ifs(file);
+    std::string json(iterator_t(ifs), (iterator_t()));
+    ASSERT_FALSE(json.empty()) << file;
+
+    Object expected = FromJSON(json);
+    for (JSONFormat_t format : {kCompact, kPretty}) {
+      Object actual = FromJSON(ToJSON(expected, format));
+      ASSERT_EQ(std::string(expected.RawData(), expected.TotalSize()),
+                std::string(actual.RawData(), actual.TotalSize()))
+          << file;
+    }
+  }
+}
+
+TEST(ToJSON, Sink) {
+  std::ifstream ifs("../../data/mock.json");
+  typedef std::istreambuf_iterator<char> iterator_t;
+  std::string json(iterator_t(ifs), (iterator_t()));
+  ASSERT_FALSE(json.empty());
+
+  Object obj = FromJSON(json);
+  std::string expected = ToJSON(obj);
+
+  // Callback
+  std::string actual;
+  size_t pieces = 0;
+  CallbackSink callback([&](Slice piece) {
+    actual.append(piece.RawData(), piece.Len());
+    pieces++;
+    return Status::OK();
+  });
+  JSONWriter writer;
+  ASSERT_TRUE(writer.Write(obj, &callback, 1024).IsOK());
+  ASSERT_EQ(actual, expected);
+  ASSERT_GT(pieces, expected.size() / 1024);
+
+  // std::ostream
+  std::ostringstream oss;
+  OStreamSink ostream(oss);
+  ASSERT_TRUE(ToJSON(obj, &ostream).IsOK());
+  ASSERT_EQ(oss.str(), expected);
+
+  // File descriptor
+  FILE *file = tmpfile();
+  ASSERT_TRUE(file != nullptr);
+  FdSink fd(fileno(file));
+  ASSERT_TRUE(ToJSON(obj, &fd).IsOK());
+  rewind(file);
+  actual.assign(expected.size() + 1, '\0');
+  ASSERT_EQ(fread(&actual[0], 1, actual.size(), file), expected.size());
+  actual.resize(expected.size());
+  ASSERT_EQ(actual, expected);
+  fclose(file);
+
+  // Any number of pieces at once, including empty ones.
+  file = tmpfile();
+  ASSERT_TRUE(file != nullptr);
+  FdSink many(fileno(file));
+  std::vector<std::string> strings;
+  for (int i = 0; i < 100; i++)
+    strings.push_back(i % 3 == 0 ? std::string() : std::to_string(i));
+  std::vector<Slice> slices(strings.begin(), strings.end());
+  ASSERT_TRUE(many.Consume(slices.data(), slices.size()).IsOK());
+  std::string concatenated;
+  for (const std::string &str : strings)
+    concatenated += str;
+  rewind(file);
+  actual.assign(concatenated.size() + 1, '\0');
+  ASSERT_EQ(fread(&actual[0], 1, actual.size(), file), concatenated.size());
+  actual.resize(concatenated.size());
+  ASSERT_EQ(actual, concatenated);
+  fclose(file);
+
+  // Errors stop the writer.
+  size_t calls = 0;
+  CallbackSink failing([&](Slice) {
+    calls++;
+    return Status::IOError("disk full");
+  });
+  Status s = writer.Write(obj, &failing, 1024);
+  ASSERT_TRUE(s.IsIOError());
+  ASSERT_EQ(calls, 1u);
+
+  // The writer is still usable afterwards.
+  ASSERT_EQ(writer.Write(obj).ToString(), expected);
+}
+
+TEST(IncrementalParser, Chunks) {
+  const char *files[] = {"../../data/canada.json", "../../data/mock.json",
+                         "../../data/type.json",   "../../data/allOf.json",
+                         "../../data/default.json", "../../data/anyOf.json"};
+  typedef std::istreambuf_iterator<char> iterator_t;
+
+  for (const char *file : files) {
+    std::ifstream ifs(file);
+    std::string json(iterator_t(ifs), (iterator_t()));
+    ASSERT_FALSE(json.empty()) << file;
+    Object expected = FromJSON(json);
+
+    // Chunk boundaries fall everywhere, including within strings, escape
+    // sequences and numbers.
+    for (size_t chunkSize : {1, 3, 64, 4096}) {
+      if (chunkSize < 64 && json.size() > 100000)
+        continue;
+
+      IncrementalParser parser;
+      std::vector<Object> objects;
+      for (size_t i = 0; i < json.size(); i += chunkSize) {
+        Slice chunk(json.data() + i, std::min(chunkSize, json.size() - i));
+        ASSERT_TRUE(parser.Feed(chunk, &objects).IsOK()) << file;
+      }
+      ASSERT_TRUE(parser.Finish().IsOK()) << file;
+
+      ASSERT_EQ(objects.size(), 1u) << file;
+      ASSERT_EQ(std::string(expected.RawData(), expected.TotalSize()),
+                std::string(objects[0].RawData(), objects[0].TotalSize()))
+          << file << " " << chunkSize;
+    }
+  }
+}
+
+TEST(IncrementalParser, Stream) {
+  IncrementalParser parser;
+  std::vector<Object> objects;
+
+  ASSERT_TRUE(parser.Feed("{\"a\" : 1}\n{\"b\" : [tr", &objects).IsOK());
+  ASSERT_EQ(objects.size(), 1u);
+  ASSERT_TRUE(parser.InDocument());
+
+  ASSERT_TRUE(parser.Feed("ue, \"x\\", &objects).IsOK());
+  ASSERT_TRUE(parser.Feed("ny\"]} [1, 2.5]", &objects).IsOK());
+  ASSERT_FALSE(parser.InDocument());
+  ASSERT_TRUE(parser.Finish().IsOK());
+
+  ASSERT_EQ(objects.size(), 3u);
+  ASSERT_EQ(objects[0].find("a")->ValueOf<int>(), 1);
+  ASSERT_EQ(ToJSON(objects[1]), "{\"b\":[true,\"x\\ny\"]}");
+  ASSERT_EQ(objects[2].NumFields(), 2);
+}
+
+TEST(IncrementalParser, UnicodeEscapes) {
+  std::string json =
+      "{\"caf\\u00e9\" : \"\\u20ac \\ud83d\\ude00\\n\\u0041\\\"\", \"b\" : 1}";
+  Object expected = FromJSON(json);
+  ASSERT_EQ(expected.find("caf\xc3\xa9")->ValueOf<Slice>().ToString(),
+            "\xe2\x82\xac \xf0\x9f\x98\x80\nA\"");
+
+  for (size_t chunkSize = 1; chunkSize <= json.size(); chunkSize++) {
+    IncrementalParser parser;
+    std::vector<Object> objects;
+    for (size_t i = 0; i < json.size(); i += chunkSize) {
+      Slice chunk(json.data() + i, std::min(chunkSize, json.size() - i));
+      ASSERT_TRUE(parser.Feed(chunk, &objects).IsOK()) << chunkSize;
+    }
+    ASSERT_EQ(objects.size(), 1u);
+    ASSERT_EQ(std::string(expected.RawData(), expected.TotalSize()),
+              std::string(objects[0].RawData(), objects[0].TotalSize()))
+        << chunkSize;
+  }
+}
+
+TEST(IncrementalParser, Invalid) {
+  const char *invalid[] = {"[1,]", "{\"a\" 1}", "{\"a\":}", "{1:2}",
+                           "[1 2]", "[tru]", "[1e999]", "x"};
+  const char *malformed[] = {"[\"\\u12x4\"]", "[\"\\ud800 and more\"]",
+                             "{\"\\udc00\" : 1}"};
+  for (const char *json : malformed) {
+    IncrementalParser parser;
+    std::vector<Object> objects;
+    ASSERT_TRUE(parser.Feed(json, &objects).IsFailedToParse()) << json;
+  }
+
+  for (const char *json : invalid) {
+    IncrementalParser parser;
+    std::vector<Object> objects;
+    Status s = parser.Feed(json, &objects);
+    ASSERT_TRUE(s.IsFailedToParse()) << json;
+
+    // The parser stays failed until it's reset.
+    ASSERT_TRUE(parser.Feed("{}", &objects).IsFailedToParse());
+    parser.Reset();
+    ASSERT_TRUE(parser.Feed("{}", &objects).IsOK());
+    ASSERT_EQ(objects.size(), 1u);
+  }
+
+  IncrementalParser parser;
+  std::vector<Object> objects;
+  ASSERT_TRUE(parser.Feed("{\"a\" : [1, 2", &objects).IsOK());
+  ASSERT_TRUE(parser.Finish().IsFailedToParse());
+}
+
+TEST(BatchParser, NDJSON) {
+  std::ifstream ifs("../../data/mock.json");
+  typedef std::istreambuf_iterator<char> iterator_t;
+  std::string json(iterator_t(ifs), (iterator_t()));
+  ASSERT_FALSE(json.empty());
+
+  // One line per element of the root array.
+  Object root = FromJSON(json);
+  std::vector<std::string> expected;
+  std::string ndjson;
+  for (const Element &e : root) {
+    Object record(SharedBuffer(root.ShareFromThis(), e.RawValue()));
+    expected.push_back(std::string(record.RawData(), record.TotalSize()));
+    ndjson += ToJSON(record) + "\n";
+  }
+
+  // Small batches make the records span several of them.
+  BatchParser parser(4096);
+  std::vector<BatchParser::RecordError> errors;
+  std::vector<Object> objects = parser.Parse(ndjson, &errors);
+  ASSERT_TRUE(errors.empty());
+  ASSERT_EQ(objects.size(), expected.size());
+  for (size_t i = 0; i < objects.size(); i++)
+    ASSERT_EQ(std::string(objects[i].RawData(), objects[i].TotalSize()),
+              expected[i]);
+}
+
+TEST(BatchParser, Errors) {
+  std::string input =
+      "{\"a\" : 1}\n"
+      "{\"b\" : [1, {\"c\" : }]}\n"
+      "  {\"d\" : 2} {\"e\" : 3}\n"
+      "oops\n"
+      "[4]";
+
+  BatchParser parser;
+  std::vector<BatchParser::RecordError> errors;
+  std::vector<Object> objects = parser.Parse(input, &errors);
+
+  ASSERT_EQ(objects.size(), 4u);
+  ASSERT_EQ(ToJSON(objects[0]), "{\"a\":1}");
+  ASSERT_EQ(ToJSON(objects[1]), "{\"d\":2}");
+  ASSERT_EQ(ToJSON(objects[2]), "{\"e\":3}");
+  ASSERT_EQ(objects[3].NumFields(), 1);
+
+  ASSERT_EQ(errors.size(), 2u);
+  ASSERT_EQ(errors[0].record, 1u);
+  ASSERT_EQ(errors[0].offset, input.find("{\"b\""));
+  ASSERT_TRUE(errors[0].status.IsFailedToParse());
+  ASSERT_EQ(errors[1].record, 4u);
+  ASSERT_EQ(errors[1].offset, input.find("oops"));
+}
+
+TEST(BatchParser, Parallel) {
+  std::ifstream ifs("../../data/mock.json");
+  typedef std::istreambuf_iterator<char> iterator_t;
+  std::string json(iterator_t(ifs), (iterator_t()));
+  ASSERT_FALSE(json.empty());
+
+  // Large enough for many chunks, with a few bad records in between.
+  Object root = FromJSON(json);
+  std::string ndjson;
+  for (int i = 0; i < 4; i++) {
+    for (const Element &e : root) {
+      Object record(SharedBuffer(root.ShareFromThis(), e.RawValue()));
+      ndjson += ToJSON(record) + "\n";
+    }
+    ndjson += "{\"bad\" : }\n";
+  }
+
+  BatchParser parser;
+  std::vector<BatchParser::RecordError> expectedErrors;
+  std::vector<Object> expected = parser.Parse(ndjson, &expectedErrors);
+  ASSERT_EQ(expectedErrors.size(), 4u);
+
+  for (int threads : {2, 3, 8}) {
+    std::vector<BatchParser::RecordError> errors;
+    std::vector<Object> objects =
+        parser.ParseParallel(ndjson, threads, &errors);
+
+    ASSERT_EQ(objects.size(), expected.size());
+    for (size_t i = 0; i < objects.size(); i++)
+      ASSERT_EQ(std::string(objects[i].RawData(), objects[i].TotalSize()),
+                std::string(expected[i].RawData(), expected[i].TotalSize()));
+
+    ASSERT_EQ(errors.size(), expectedErrors.size());
+    for (size_t i = 0; i < errors.size(); i++) {
+      ASSERT_EQ(errors[i].record, expectedErrors[i].record);
+      ASSERT_EQ(errors[i].offset, expectedErrors[i].offset);
+    }
+  }
+
+  ASSERT_TRUE(parser.ParseParallel("", 4).empty());
+}
+
+// Write "contents" to a new temporary file.
+static std::string MakeTempFile(const std::string &contents) {
+  char path[] = "/tmp/bson_unittest_XXXXXX";
+  int fd = mkstemp(path);
+  EXPECT_GE(fd, 0);
+  EXPECT_EQ(write(fd, contents.data(), contents.size()),
+            static_cast<ssize_t>(contents.size()));
+  close(fd);
+  return path;
+}
+
+TEST(BSONFileReader, Basic) {
+  std::string dump;
+  for (int i = 0; i < 100; i++) {
+    ObjectBuilder builder;
+    builder.Append("i", i).Append("s", Slice(std::string(i, 'x')));
+    Object obj = builder.Done();
+    dump.append(obj.RawData(), obj.TotalSize());
+  }
+  std::string path = MakeTempFile(dump);
+
+  for (bool index : {false, true}) {
+    BSONFileReader reader;
+    ASSERT_TRUE(reader.Open(path, BSONFileReader::kSequential, index).IsOK());
+    ASSERT_EQ(reader.Data().Len(), dump.size());
+
+    ObjectView doc;
+    int n = 0;
+    while (reader.Next(&doc)) {
+      ASSERT_EQ(doc["i"].ValueOf<int>(), n);
+      ASSERT_EQ(doc["s"].ValueOf<Slice>().Len(), static_cast<size_t>(n));
+      n++;
+    }
+    ASSERT_TRUE(reader.status().IsOK());
+    ASSERT_EQ(n, 100);
+
+    reader.Rewind();
+    ASSERT_TRUE(reader.Next(&doc));
+    ASSERT_EQ(doc["i"].ValueOf<int>(), 0);
+
+    for (int i : {42, 7, 99, 0}) {
+      ASSERT_TRUE(reader.Get(i, &doc).IsOK());
+      ASSERT_EQ(doc["i"].ValueOf<int>(), i);
+    }
+    ASSERT_TRUE(reader.Get(100, &doc).IsIOError());
+
+    size_t count = 0;
+    ASSERT_TRUE(reader.NumDocuments(&count).IsOK());
+    ASSERT_EQ(count, 100u);
+  }
+
+  unlink(path.c_str());
+}
+
+TEST(BSONFileReader, Invalid) {
+  BSONFileReader reader;
+  ASSERT_TRUE(reader.Open("/nonexistent/dump.bson").IsIOError());
+  ASSERT_FALSE(reader.IsOpen());
+
+  std::string path = MakeTempFile("");
+  ASSERT_TRUE(reader.Open(path).IsOK());
+  ObjectView doc;
+  ASSERT_FALSE(reader.Next(&doc));
+  ASSERT_TRUE(reader.status().IsOK());
+  unlink(path.c_str());
+
+  ObjectBuilder builder;
+  builder.Append("a", 1);
+  Object obj = builder.Done();
+  std::string dump(obj.RawData(), obj.TotalSize());
+
+  // The second document is truncated.
+  path = MakeTempFile(dump + dump.substr(0, dump.size() - 1));
+  ASSERT_TRUE(reader.Open(path).IsOK());
+  ASSERT_TRUE(reader.Next(&doc));
+  ASSERT_FALSE(reader.Next(&doc));
+  ASSERT_TRUE(reader.status().IsCorruption());
+
+  // The documents before the corruption can be read again.
+  reader.Rewind();
+  ASSERT_TRUE(reader.status().IsOK());
+  ASSERT_TRUE(reader.Next(&doc));
+  ASSERT_EQ(doc["a"].ValueOf<int>(), 1);
+  ASSERT_FALSE(reader.Next(&doc));
+  ASSERT_TRUE(reader.status().IsCorruption());
+  size_t count;
+  ASSERT_TRUE(reader.NumDocuments(&count).IsCorruption());
+  unlink(path.c_str());
+}
+
+TEST(BSONFileWriter, Basic) {
+  std::vector<Object> objects;
+  for (int i = 0; i < 1000; i++) {
+    ObjectBuilder builder;
+    // A few of the objects are larger than the buffer.
+    builder.Append("i", i).Append(
+        "s", Slice(std::string(i % 100 == 0 ? 5000 : i % 10, 'x')));
+    objects.push_back(builder.Done());
+  }
+
+  std::string path = MakeTempFile("");
+  BSONFileWriter::Options options;
+  options.bufferSize = 4096;
+
+  for (auto sync : {BSONFileWriter::kSyncNever,
+                    BSONFileWriter::kSyncEveryDocument,
+                    BSONFileWriter::kSyncEveryNBytes,
+                    BSONFileWriter::kSyncPeriodically}) {
+    ASSERT_EQ(truncate(path.c_str(), 0), 0);
+
+    options.sync = sync;
+    BSONFileWriter writer;
+    ASSERT_TRUE(writer.Open(path, options).IsOK());
+    size_t expectedSize = 0;
+    for (const Object &obj : objects) {
+      ASSERT_TRUE(writer.Append(obj).IsOK());
+      expectedSize += obj.TotalSize();
+    }
+    ASSERT_EQ(writer.BytesAppended(), expectedSize);
+    if (sync == BSONFileWriter::kSyncEveryDocument)
+      ASSERT_EQ(writer.NumWrites(), objects.size());
+    else
+      ASSERT_LE(writer.NumWrites(), expectedSize / 4096 + 1);
+    ASSERT_TRUE(writer.Close().IsOK());
+
+    BSONFileReader reader;
+    ASSERT_TRUE(reader.Open(path).IsOK());
+    ASSERT_EQ(reader.Data().Len(), expectedSize);
+    ObjectView doc;
+    size_t n = 0;
+    while (reader.Next(&doc)) {
+      ASSERT_EQ(0, memcmp(doc.RawData(), objects[n].RawData(),
+                          objects[n].TotalSize()));
+      n++;
+    }
+    ASSERT_TRUE(reader.status().IsOK());
+    ASSERT_EQ(n, objects.size());
+  }
+
+  // Appending to an existing file.
+  BSONFileWriter writer;
+  ASSERT_TRUE(writer.Open(path).IsOK());
+  ASSERT_TRUE(writer.Append(objects[1]).IsOK());
+  ASSERT_TRUE(writer.Close().IsOK());
+
+  BSONFileReader reader;
+  size_t count = 0;
+  ASSERT_TRUE(reader.Open(path).IsOK());
+  ASSERT_TRUE(reader.NumDocuments(&count).IsOK());
+  ASSERT_EQ(count, objects.size() + 1);
+
+  unlink(path.c_str());
+  ASSERT_TRUE(writer.Open("/nonexistent/dump.bson").IsIOError());
+}
+
+TEST(FieldPath, Extract) {
+  Object obj = FromJSON(
+      "{'name' : 'a', 'friends' : [{'name' : 'b'}, {'name' : 'c', 'age' : 3}],"
+      " 'x' : {'y' : {'z' : 1.5}, '3' : 'three'}, 'a.b' : 1, 'x' : 2}");
+
+  const char *paths[] = {"name",      "friends.1.name", "friends.1.age",
+                         "x.y.z",     "x.3",            "friends.0",
+                         "friends.2", "friends.name",   "name.x",
+                         "x.y.z.w",   "a.b",            "missing"};
+  const size_t kFound = 6;
+  std::vector<FieldPath> fieldPaths;
+  for (const char *path : paths)
+    fieldPaths.emplace_back(path);
+  ASSERT_EQ(fieldPaths[1].NumComponents(), 3u);
+
+  Element e;
+  ASSERT_TRUE(fieldPaths[0].Extract(obj, &e));
+  ASSERT_EQ(e.ValueOf<Slice>().ToString(), "a");
+  ASSERT_TRUE(fieldPaths[1].Extract(obj, &e));
+  ASSERT_EQ(e.ValueOf<Slice>().ToString(), "c");
+  ASSERT_TRUE(fieldPaths[2].Extract(obj, &e));
+  ASSERT_EQ(e.ValueOf<int>(), 3);
+  // The first "x" is taken.
+  ASSERT_TRUE(fieldPaths[3].Extract(obj, &e));
+  ASSERT_EQ(e.ValueOf<double>(), 1.5);
+  ASSERT_TRUE(fieldPaths[4].Extract(obj, &e));
+  ASSERT_EQ(e.ValueOf<Slice>().ToString(), "three");
+  ASSERT_TRUE(fieldPaths[5].Extract(obj, &e));
+  ASSERT_EQ(e.Type(), kObject);
+  for (size_t i = 6; i < fieldPaths.size(); i++)
+    ASSERT_FALSE(fieldPaths[i].Extract(obj, &e)) << paths[i];
+
+  // All at once, in any order.
+  std::reverse(fieldPaths.begin(), fieldPaths.end());
+  std::vector<Element> results(fieldPaths.size());
+  ASSERT_EQ(FieldPath::Extract(obj, fieldPaths.data(), fieldPaths.size(),
+                               results.data()),
+            kFound);
+  for (size_t i = 0; i < fieldPaths.size(); i++) {
+    Element expected;
+    if (fieldPaths[i].Extract(obj, &expected))
+      ASSERT_EQ(results[i].RawData(), expected.RawData()) << paths[i];
+    else
+      ASSERT_EQ(results[i].Type(), kEOO);
+  }
+}
+
+static size_t CountElements(const ObjectView &obj) {
+  size_t n = 0;
+  for (const Element &e : obj) {
+    n++;
+    if (e.Type() == kObject || e.Type() == kArray)
+      n += CountElements(e.ValueOf<ObjectView>());
+  }
+  return n;
+}
+
+TEST(Validate, Valid) {
+  for (const char *file : {"../../data/canada.json", "../../data/mock.json",
+                           "../../data/type.json"}) {
+    std::ifstream ifs(file);
+    typedef std::istreambuf_iterator<char> iterator_t;
+    std::string json(iterator_t(ifs), (iterator_t()));
+    Object obj = FromJSON(json);
+    ASSERT_TRUE(Validate(obj.RawData(), obj.TotalSize()).IsOK()) << file;
+    ASSERT_TRUE(Validate(obj.RawData(), obj.TotalSize() - 1).IsCorruption());
+  }
+
+  ObjectBuilder builder;
+  Object empty = builder.Done();
+  ASSERT_TRUE(Validate(empty.RawData(), empty.TotalSize()).IsOK());
+  ASSERT_TRUE(Validate(empty.RawData(), 4).IsCorruption());
+}
+
+TEST(Validate, Corrupted) {
+  Object obj = FromJSON(
+      "{'s' : 'sunshine', 'o' : {'a' : [1, 2.5, true, null]}, "
+      "'l' : NumberLong(3), 'd' : Datetime(4), 'x' : {}}");
+  std::string bytes(obj.RawData(), obj.TotalSize());
+
+  // Whatever byte is changed, either the object is rejected or it can be
+  // iterated within its bounds, which ASAN checks here.
+  for (size_t i = 0; i < bytes.size(); i++) {
+    for (int v : {0, 1, 2, 3, 4, 8, 0x7f, 0xff}) {
+      std::string corrupted = bytes;
+      corrupted[i] = static_cast<char>(v);
+      std::unique_ptr<char[]> exact(new char[corrupted.size()]);
+      memcpy(exact.get(), corrupted.data(), corrupted.size());
+      if (Validate(exact.get(), corrupted.size()))
+        CountElements(ObjectView(exact.get()));
+    }
+  }
+
+  ASSERT_TRUE(Validate(bytes.data(), bytes.size()).IsOK());
+  std::string unknownType = bytes;
+  unknownType[4] = 0x20;
+  Status s = Validate(unknownType.data(), unknownType.size());
+  ASSERT_EQ(s.ToString(), "Corruption: unknown type at offset 4");
+
+  // Deep nesting is rejected without blowing the stack.
+  ObjectBuilder builder;
+  for (int i = 0; i < kMaxValidateDepth + 1; i++)
+    builder.BeginSubObject("o");
+  for (int i = 0; i < kMaxValidateDepth + 1; i++)
+    builder.EndSubObject();
+  Object nested = builder.Done();
+  s = Validate(nested.RawData(), nested.TotalSize());
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+}
+
+TEST(Validate, AllTypes) {
+  ObjectId oid;
+  ASSERT_TRUE(ObjectId::FromString("507f1f77bcf86cd799439011", &oid));
+  ObjectBuilder scopeBuilder;
+  scopeBuilder.Append("x", 1);
+  Object scope = scopeBuilder.Done();
+
+  ObjectBuilder builder;
+  builder.Append("oid", oid)
+      .Append("bin", BinData{0, Slice("hello")})
+      .Append("ts", Timestamp{7, 1500000000})
+      .Append("dec", Decimal128{15, 0xB03E000000000000ULL})
+      .Append("re", Regex{"^a.*", "i"})
+      .Append("code", Code{"return 1"})
+      .Append("sym", Symbol{"sym"})
+      .Append("cws", CodeWScope{"return x", scope})
+      .Append("ptr", DBPointer{"db.c", oid})
+      .Append("undef", Undefined())
+      .Append("min", MinKey())
+      .Append("max", MaxKey());
+  Object obj = builder.Done();
+
+  ASSERT_TRUE(Validate(obj.RawData(), obj.TotalSize()).IsOK());
+  ASSERT_EQ(ToJSON(obj),
+            "{\"oid\":ObjectId(\"507f1f77bcf86cd799439011\"),"
+            "\"bin\":BinData(0,\"aGVsbG8=\"),"
+            "\"ts\":Timestamp(1500000000,7),"
+            "\"dec\":NumberDecimal(\"-1.5\"),"
+            "\"re\":/^a.*/i,"
+            "\"code\":Code(\"return 1\"),"
+            "\"sym\":\"sym\","
+            "\"cws\":Code(\"return x\",{\"x\":1}),"
+            "\"ptr\":DBPointer(\"db.c\","
+            "ObjectId(\"507f1f77bcf86cd799439011\")),"
+            "\"undef\":undefined,"
+            "\"min\":MinKey,"
+            "\"max\":MaxKey}");
+  std::string pretty = ToJSON(obj, kPretty);
+  ASSERT_NE(pretty.find("BinData(0, \"aGVsbG8=\")"), std::string::npos);
+  ASSERT_NE(pretty.find("Timestamp(1500000000, 7)"), std::string::npos);
+  ASSERT_NE(pretty.find("DBPointer(\"db.c\", ObjectId("), std::string::npos);
+
+  // Corrupted bytes are rejected, or leave the object iterable within its
+  // bounds.
+  std::string bytes(obj.RawData(), obj.TotalSize());
+  for (size_t i = 0; i < bytes.size(); i++) {
+    for (int v : {0, 1, 5, 0x0b, 0x0f, 0x7f, 0xff}) {
+      std::unique_ptr<char[]> exact(new char[bytes.size()]);
+      memcpy(exact.get(), bytes.data(), bytes.size());
+      exact[i] = static_cast<char>(v);
+      if (Validate(exact.get(), bytes.size()))
+        CountElements(ObjectView(exact.get()));
+    }
+  }
+}
@@ -16,6 +16,7 @@
  */
 
 #include <gtest/gtest.h>
+#include <vector>
 #include <boost/endian/buffers.hpp>
 
 #include "BufBuilder.h"
@@ -64,7 +65,8 @@ TEST(Basic, Ownership) {
     builder.AppendStr("yes");
     builder.AppendBuf("000", 3);
 
-    sp.reset(builder.Release());
+    sp.reset(builder.Release(),
+             [](const char *p) { std::free(const_cast<char *>(p)); });
   }
 
   ASSERT_EQ(0, memcmp(sp.get(), little_int64_buf_t(1000LL).data(),
@@ -72,4 +74,127 @@ TEST(Basic, Ownership) {
   ASSERT_EQ(0, strcmp(sp.get() + sizeof(long long), "yes"));
   ASSERT_EQ(0, memcmp(sp.get() + sizeof(long long) + 4, "000", 3));
   ASSERT_EQ(ConstDataView(sp.get()).ReadNum<long long>(), 1000LL);
-}
\ No newline at end of file
+}
+TEST(Basic, Inline) {
+  BufBuilder builder;
+  const char *inlineBuf = builder.Buf();
+  builder.AppendStr("yes");
+
+  // Small buffers are released into a block of their exact size.
+  std::shared_ptr<const char> small(builder.Release(), [](const char *p) {
+    std::free(const_cast<char *>(p));
+  });
+  ASSERT_NE(small.get(), inlineBuf);
+  ASSERT_STREQ(small.get(), "yes");
+  ASSERT_EQ(builder.Len(), 0);
+  ASSERT_EQ(builder.Buf(), inlineBuf);
+
+  // Spills to the heap once too large.
+  for (int i = 0; i < BufBuilder::kInlineSize; i++)
+    builder.AppendNum(i);
+  ASSERT_NE(builder.Buf(), inlineBuf);
+  for (int i = 0; i < BufBuilder::kInlineSize; i++)
+    ASSERT_EQ(ConstDataView(builder.Buf() + i * sizeof(int)).ReadNum<int>(), i);
+}
+
+TEST(Basic, SizeHint) {
+  SizeHint hint;
+  ASSERT_EQ(hint.Get(), 0);
+  hint.Update(1000);
+  hint.Update(100);
+  ASSERT_LT(hint.Get(), 1000);
+  ASSERT_GT(hint.Get(), 100);
+  for (int i = 0; i < 100; i++)
+    hint.Update(100);
+  ASSERT_LT(hint.Get(), 100 + 8);
+  hint.Update(2000);
+  ASSERT_EQ(hint.Get(), 2000);
+}
+
+TEST(Arena, Allocate) {
+  Arena arena(1024);
+  ASSERT_EQ(arena.BytesAllocated(), 0);
+
+  char *a = static_cast<char *>(arena.Allocate(10));
+  char *b = static_cast<char *>(arena.Allocate(10));
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(a) % 8, 0);
+  ASSERT_EQ(b, a + 16);  // aligned to 8 bytes
+  size_t allocated = arena.BytesAllocated();
+
+  // The latest allocation grows in place.
+  memcpy(b, "0123456789", 10);
+  ASSERT_EQ(arena.Reallocate(b, 10, 100), b);
+  ASSERT_EQ(arena.BytesAllocated(), allocated);
+
+  // Others are moved.
+  memcpy(a, "abcdefghij", 10);
+  char *c = static_cast<char *>(arena.Reallocate(a, 10, 20));
+  ASSERT_NE(c, a);
+  ASSERT_EQ(0, memcmp(c, "abcdefghij", 10));
+
+  // Large allocations get blocks of their own.
+  char *d = static_cast<char *>(arena.Allocate(4096));
+  memset(d, 0, 4096);
+  ASSERT_GT(arena.BytesAllocated(), allocated + 4096);
+
+  arena.Clear();
+  ASSERT_EQ(arena.BytesAllocated(), 0);
+}
+
+TEST(Arena, BufBuilder) {
+  Arena arena(256);
+  BufBuilder builder(8, &arena);
+  for (int i = 0; i < 1000; i++)
+    builder.AppendNum(i);
+
+  ASSERT_EQ(builder.Len(), 1000 * sizeof(int));
+  for (int i = 0; i < 1000; i++)
+    ASSERT_EQ(ConstDataView(builder.Buf() + i * sizeof(int)).ReadNum<int>(), i);
+}
+
+TEST(BufferPool, Recycle) {
+  BufferPool pool;
+  void *a = pool.Allocate(100);
+  void *b = pool.Allocate(3000);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(a) % 16, 0);
+
+  // Grows in place within the size class.
+  ASSERT_EQ(pool.Reallocate(a, 100, BufferPool::kMinBufferSize), a);
+
+  pool.Deallocate(a);
+  pool.Deallocate(b);
+  ASSERT_EQ(pool.NumFreeBuffers(), 2);
+
+  // best fit
+  ASSERT_EQ(pool.Allocate(1000), b);
+  ASSERT_EQ(pool.Allocate(10), a);
+  ASSERT_EQ(pool.NumFreeBuffers(), 0);
+  pool.Deallocate(a);
+  pool.Deallocate(b);
+
+  // Large buffers aren't kept.
+  pool.Deallocate(pool.Allocate(BufferPool::kMaxBufferSize + 1));
+  ASSERT_EQ(pool.NumFreeBuffers(), 2);
+
+  std::vector<void *> buffers;
+  for (int i = 0; i < BufferPool::kMaxBuffers + 2; i++)
+    buffers.push_back(pool.Allocate(64));
+  for (void *p : buffers)
+    pool.Deallocate(p);
+  ASSERT_EQ(pool.NumFreeBuffers(), BufferPool::kMaxBuffers);
+  for (void *&p : buffers)
+    p = pool.Allocate(64);
+  ASSERT_EQ(pool.FreeBytes(), 0);
+
+  // Neither is more than kMaxPoolSize bytes in all.
+  std::vector<void *> large;
+  for (int i = 0; i < BufferPool::kMaxBuffers; i++)
+    large.push_back(pool.Allocate(BufferPool::kMaxBufferSize));
+  for (void *p : large)
+    pool.Deallocate(p);
+  ASSERT_EQ(pool.FreeBytes(), BufferPool::kMaxPoolSize);
+  ASSERT_EQ(pool.NumFreeBuffers(),
+            BufferPool::kMaxPoolSize / BufferPool::kMaxBufferSize);
+  for (void *p : buffers)
+    pool.Deallocate(p);
+}
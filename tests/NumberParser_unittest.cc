@@ -0,0 +1,228 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <gtest/gtest.h>
+
+#include "internal/NumberFormatter.h"
+#include "internal/NumberParser.h"
+
+using namespace bson;
+using namespace bson::internal;
+
+namespace {
+
+// Parses "s" as a whole and compares the result bitwise with strtod.
+void expectSameAsStrtod(const std::string &s) {
+  NumberValue num;
+  const char *end = s.data() + s.size();
+  ASSERT_EQ(ParseNumber(s.data(), end, &num), end) << s;
+  ASSERT_EQ(num.type, kNumberDouble) << s;
+
+  double expected = strtod(s.c_str(), nullptr);
+  ASSERT_EQ(memcmp(&num.doubleVal, &expected, sizeof(double)), 0)
+      << s << ": " << num.doubleVal << " != " << expected;
+}
+
+}  // namespace
+
+TEST(NumberParser, Integers) {
+  struct {
+    const char *str;
+    Type_t type;
+    long long val;
+  } a[] = {
+      {"0", kNumberInt, 0},
+      {"-0", kNumberInt, 0},
+      {"+12", kNumberInt, 12},
+      {"007", kNumberInt, 7},
+      {"2147483647", kNumberInt, 2147483647LL},
+      {"-2147483648", kNumberInt, -2147483648LL},
+      {"2147483648", kNumberLong, 2147483648LL},
+      {"-2147483649", kNumberLong, -2147483649LL},
+      {"9223372036854775807", kNumberLong,
+       std::numeric_limits<long long>::max()},
+      {"-9223372036854775808", kNumberLong,
+       std::numeric_limits<long long>::min()},
+      {"0000000000000000000000000000042", kNumberInt, 42},
+  };
+
+  for (auto &t : a) {
+    NumberValue num;
+    const char *end = t.str + strlen(t.str);
+    ASSERT_EQ(ParseNumber(t.str, end, &num), end) << t.str;
+    ASSERT_EQ(num.type, t.type) << t.str;
+    if (t.type == kNumberInt)
+      ASSERT_EQ(num.intVal, t.val) << t.str;
+    else
+      ASSERT_EQ(num.longVal, t.val) << t.str;
+  }
+
+  // Integers beyond int64 are doubles.
+  expectSameAsStrtod("9223372036854775808");
+  expectSameAsStrtod("-9223372036854775809");
+  expectSameAsStrtod("18446744073709551616");
+  expectSameAsStrtod("123456789012345678901234567890");
+}
+
+TEST(NumberParser, Doubles) {
+  const char *a[] = {
+      "0.0", "-0.0", "1.", ".5", "1e0", "1E+2", "2.5e-3", "0e999999999",
+      "3.141592653589793", "2.22507e-30", "1.7976931348623157e308",
+      "4.9406564584124654e-324", "2.2250738585072011e-308",
+      "2.2250738585072014e-308", "1e-400", "9007199254740993.0",
+      "9007199254740992.5", "1e23", "8.98846567431158e307",
+      "0.1000000000000000055511151231257827021181583404541015625",
+      "0.10000000000000000555111512312578270211815834045410156250001",
+      "2.4703282292062327208828439643411068618252990130716238221279284125033775"
+      "3635104375932649918180817996189898282347722858865463328355177969898199387"
+      "4e-324",
+      "2.4703282292062327208828439643411068618252990130716238221279284125033775"
+      "3635104375932649918180817996189898282347722858865463328355177969898199388"
+      "e-324",
+      "7.2057594037927933e16", "1.00000000000000011102230246251565404236316680908203125",
+      "1.00000000000000011102230246251565404236316680908203124",
+      "1.00000000000000011102230246251565404236316680908203126",
+      "0.000000000000000000000000000000000000000000001234567890123456789012",
+  };
+  for (const char *s : a)
+    expectSameAsStrtod(s);
+}
+
+TEST(NumberParser, Random) {
+  std::mt19937_64 rng(20161018);
+  char buf[64];
+  for (int i = 0; i < 200000; i++) {
+    // Doubles printed with various precisions.
+    uint64_t bits = rng();
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    if (d != d || d - d != 0)
+      continue;
+    snprintf(buf, sizeof(buf), "%.*e", static_cast<int>(rng() % 20), d);
+    expectSameAsStrtod(buf);
+
+    // Random decimals.
+    int len = snprintf(buf, sizeof(buf), "%llu.%llue%d",
+                       static_cast<unsigned long long>(rng() >> (rng() % 64)),
+                       static_cast<unsigned long long>(rng()),
+                       static_cast<int>(rng() % 700) - 350);
+    expectSameAsStrtod(std::string(buf, len));
+  }
+}
+
+TEST(NumberParser, Overflow) {
+  NumberValue num;
+  const char *s = "1e309";
+  ASSERT_EQ(ParseNumber(s, s + 5, &num), s + 5);
+  ASSERT_EQ(num.type, kNumberDouble);
+  ASSERT_EQ(num.doubleVal, std::numeric_limits<double>::infinity());
+
+  s = "-1e99999999999";
+  ASSERT_EQ(ParseNumber(s, s + strlen(s), &num), s + strlen(s));
+  ASSERT_EQ(num.doubleVal, -std::numeric_limits<double>::infinity());
+}
+
+TEST(NumberParser, End) {
+  NumberValue num;
+
+  const char *invalid[] = {"", "-", "+", ".", "-.", "e5", "x1", "-e1"};
+  for (const char *s : invalid)
+    ASSERT_EQ(ParseNumber(s, s + strlen(s), &num), nullptr) << s;
+
+  // Parsing stops at the first character that isn't part of the number.
+  struct {
+    const char *str;
+    size_t len;
+  } a[] = {{"12,", 2}, {"1.5]", 3}, {"1e", 1}, {"1e+", 1}, {"2E-x", 1},
+           {"-3.0e5}", 6}, {"1.2.3", 3}, {"4 ", 1}};
+  for (auto &t : a)
+    ASSERT_EQ(ParseNumber(t.str, t.str + strlen(t.str), &num), t.str + t.len)
+        << t.str;
+
+  // The input needn't be null-terminated.
+  const char *s = "12345";
+  ASSERT_EQ(ParseNumber(s, s + 3, &num), s + 3);
+  ASSERT_EQ(num.type, kNumberInt);
+  ASSERT_EQ(num.intVal, 123);
+}
+
+TEST(NumberFormatter, Integers) {
+  char buf[kMaxNumberLength];
+  struct {
+    long long val;
+    const char *str;
+  } a[] = {{0, "0"},
+           {7, "7"},
+           {-10, "-10"},
+           {123456789, "123456789"},
+           {std::numeric_limits<long long>::max(), "9223372036854775807"},
+           {std::numeric_limits<long long>::min(), "-9223372036854775808"}};
+  for (auto &t : a)
+    ASSERT_EQ(std::string(&buf[0], FormatInt64(t.val, buf)), t.str);
+
+  ASSERT_EQ(std::string(&buf[0], FormatInt32(std::numeric_limits<int>::min(), buf)),
+            "-2147483648");
+  ASSERT_EQ(std::string(&buf[0], FormatInt32(99, buf)), "99");
+}
+
+TEST(NumberFormatter, Doubles) {
+  char buf[kMaxNumberLength];
+  struct {
+    double val;
+    const char *str;
+  } a[] = {{0.0, "0.0"},
+           {-0.0, "-0.0"},
+           {1.0, "1.0"},
+           {0.1, "0.1"},
+           {-123.456, "-123.456"},
+           {100.0, "100.0"},
+           {1e21, "1e21"},
+           {0.001234, "0.001234"},
+           {1.5e-7, "1.5e-7"},
+           {5e-324, "5e-324"},
+           {1.7976931348623157e308, "1.7976931348623157e308"},
+           {std::numeric_limits<double>::infinity(), "Infinity"},
+           {-std::numeric_limits<double>::infinity(), "-Infinity"},
+           {std::numeric_limits<double>::quiet_NaN(), "NaN"}};
+  for (auto &t : a)
+    ASSERT_EQ(std::string(&buf[0], FormatDouble(t.val, buf)), t.str);
+}
+
+TEST(NumberFormatter, RoundTrip) {
+  std::mt19937_64 rng(20161019);
+  char buf[kMaxNumberLength];
+  for (int i = 0; i < 200000; i++) {
+    uint64_t bits = rng() >> (rng() % 64);
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    if (d != d || d - d != 0)
+      continue;
+
+    const char *end = FormatDouble(d, buf);
+    NumberValue num;
+    ASSERT_EQ(ParseNumber(buf, end, &num), end);
+    ASSERT_EQ(num.type, kNumberDouble);
+    ASSERT_EQ(memcmp(&num.doubleVal, &d, sizeof(d)), 0)
+        << std::string(buf, end - buf);
+  }
+}
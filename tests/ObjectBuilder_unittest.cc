@@ -20,7 +20,9 @@
 #include <boost/any.hpp>
 #include <glog/logging.h>
 
+#include "ArrayBuilder.h"
 #include "ObjectBuilder.h"
+#include "Projection.h"
 
 using namespace bson;
 
@@ -123,4 +125,473 @@ TEST(Append, Simple) {
   ASSERT_TRUE(i == obj.end());
   ASSERT_EQ(obj.NumFields(), sizeof(a) / sizeof(S));
   LOG(INFO) << obj.Dump();
-}
\ No newline at end of file
+}
+TEST(Append, SubObjectInPlace) {
+  ObjectBuilder inner;
+  inner.Append("x", 1).Append("y", Slice("abc"));
+  ObjectBuilder arr;
+  arr.Append("0", true).Append("1", 2.5);
+
+  ObjectBuilder expected;
+  expected.Append("a", inner.Done());
+  expected.Append("b", Array(arr.Done()));
+  expected.Append("c", 3);
+  Object expectedObj = expected.Done();
+
+  ObjectBuilder builder;
+  builder.BeginSubObject("a").Append("x", 1).Append("y", Slice("abc"));
+  builder.EndSubObject();
+  builder.BeginSubArray("b").Append("0", true).Append("1", 2.5);
+  builder.EndSubArray();
+  builder.Append("c", 3);
+  Object obj = builder.Done();
+
+  ASSERT_EQ(obj.TotalSize(), expectedObj.TotalSize());
+  ASSERT_EQ(0, memcmp(obj.RawData(), expectedObj.RawData(), obj.TotalSize()));
+  ASSERT_EQ(obj.find("a")->Type(), kObject);
+  ASSERT_EQ(obj.find("b")->Type(), kArray);
+  ASSERT_EQ(obj.find("c")->ValueOf<int>(), 3);
+}
+
+TEST(Append, NestedEmptySubObjects) {
+  ObjectBuilder builder;
+  builder.BeginSubArray("a").BeginSubObject("").BeginSubArray("");
+  builder.EndSubArray().EndSubObject().EndSubArray();
+  Object obj = builder.Done();
+
+  // {a: [{"": []}]}
+  size_t innerArr = 5;
+  size_t obj1 = 4 + (1 + 1 + innerArr) + 1;
+  size_t arr = 4 + (1 + 1 + obj1) + 1;
+  ASSERT_EQ(obj.TotalSize(), 4 + (1 + 2 + arr) + 1);
+  ASSERT_EQ(obj.NumFields(), 1);
+}
+
+TEST(Append, Truncate) {
+  ObjectBuilder expected;
+  expected.Append("a", 1);
+  Object expectedObj = expected.Done();
+
+  ObjectBuilder builder;
+  builder.Append("a", 1);
+  size_t len = builder.Len();
+
+  // Drop an element along with the unfinished embedded documents in it.
+  builder.BeginSubObject("b").Append("x", 1).BeginSubArray("y").Append("0", 2);
+  builder.Truncate(len);
+  ASSERT_EQ(builder.Len(), len);
+
+  Object obj = builder.Done();
+  ASSERT_EQ(obj.TotalSize(), expectedObj.TotalSize());
+  ASSERT_EQ(0, memcmp(obj.RawData(), expectedObj.RawData(), obj.TotalSize()));
+}
+
+TEST(Append, Arena) {
+  Arena arena;
+  std::vector<Object> objects;
+  for (int i = 0; i < 100; i++) {
+    ObjectBuilder builder(&arena);
+    builder.Append("i", i).Append("s", Slice("sunshine boys"));
+    builder.BeginSubArray("a").Append("", 1.5).Append("", true);
+    builder.EndSubArray();
+    objects.push_back(builder.Done());
+  }
+
+  for (int i = 0; i < 100; i++) {
+    Object obj = objects[i];
+    ASSERT_EQ(obj.find("i")->ValueOf<int>(), i);
+    ASSERT_EQ(obj.find("s")->ValueOf<Slice>().ToString(), "sunshine boys");
+    ASSERT_EQ(obj.NumFields(), 3);
+
+    // No reference counting is involved.
+    ASSERT_EQ(obj.ShareFromThis().use_count(), 0);
+  }
+
+  // All of the objects fit in a single block.
+  ASSERT_LE(arena.BytesAllocated(), Arena::kDefaultBlockSize + 64);
+}
+
+TEST(Append, Reset) {
+  ObjectBuilder builder;
+  builder.Append("i", 1).Append("s", Slice("sunshine boys"));
+  builder.DoneFast();
+  const char *buf = builder.View().RawData();
+  ASSERT_EQ(builder.View()["i"].ValueOf<int>(), 1);
+
+  // The buffer is reused as long as no Object took it.
+  builder.Reset();
+  builder.Append("i", 2);
+  builder.DoneFast();
+  ASSERT_EQ(builder.View().RawData(), buf);
+  ASSERT_EQ(builder.View().NumFields(), 1);
+
+  Object obj = builder.Obj();
+  builder.Reset();
+  builder.BeginSubObject("o").Append("i", 3);
+  builder.EndSubObject();
+  Object other = builder.Done();
+  ASSERT_NE(other.RawData(), obj.RawData());
+  ASSERT_EQ(obj["i"].ValueOf<int>(), 2);
+  ASSERT_EQ(other.NumFields(), 1);
+  ASSERT_EQ(other["o"].Type(), kObject);
+}
+
+TEST(Append, BufferPool) {
+  BufferPool pool;
+  ObjectBuilder builder(&pool, 1000);
+  std::string str(900, 'x');
+  size_t numFree = BufferPool::Local()->NumFreeBuffers();
+  const char *buf;
+  {
+    builder.Append("s", str);
+    Object obj = builder.Done();
+    buf = obj.RawData();
+    ASSERT_EQ(BufferPool::CapacityOf(obj.RawData() - SharedBuffer::kHeaderSize),
+              1024);
+    builder.Reset();
+  }
+
+  // Objects hand their buffer back to the pool of the thread when they're
+  // gone.
+  ASSERT_EQ(BufferPool::Local()->NumFreeBuffers(), numFree + 1);
+
+  builder.Append("s", str);
+  Object obj = builder.Done();
+  ASSERT_NE(obj.RawData(), buf);
+  ASSERT_EQ(obj["s"].ValueOf<Slice>().ToString(), str);
+  builder.Reset();
+
+  // Objects filling less than half of the buffer get a copy of their own, the
+  // builder keeps the buffer.
+  const char *pooled = builder.TEST_BufBuilder().Buf();
+  {
+    builder.Append("i", 1);
+    Object small = builder.Done();
+    ASSERT_NE(small.RawData(), pooled + SharedBuffer::kHeaderSize);
+    ASSERT_EQ(small["i"].ValueOf<int>(), 1);
+  }
+  ASSERT_EQ(BufferPool::Local()->NumFreeBuffers(), numFree + 1);
+  builder.Reset();
+  ASSERT_EQ(builder.TEST_BufBuilder().Buf(), pooled);
+}
+
+TEST(Append, SizeHint) {
+  SizeHint hint;
+  size_t size = 0;
+  for (int round = 0; round < 2; round++) {
+    ObjectBuilder builder(&hint);
+    const char *buf = builder.TEST_BufBuilder().Buf();
+    for (int i = 0; i < 1000; i++)
+      builder.Append("i", i);
+    builder.DoneFast();
+
+    // Large enough from the start the second time.
+    if (round == 1) {
+      ASSERT_EQ(builder.TEST_BufBuilder().Buf(), buf);
+    }
+    size = builder.View().TotalSize();
+  }
+  ASSERT_EQ(hint.Get(), size);
+}
+
+TEST(Append, ArrayBuilder) {
+  ObjectBuilder builder;
+  ArrayBuilder a(builder.BeginSubArray("a"));
+  a.Append(1).Append(Slice("two"));
+  a.BeginSubObject().Append("three", 3).EndSubObject();
+  a.BeginSubArray();
+  ArrayBuilder(builder).Append(4.5);
+  builder.EndSubArray();
+  builder.AppendObjectId(a.NextKey(), ObjectId());
+  while (a.Count() < 10020)
+    a.Append(static_cast<int>(a.Count()));
+  builder.EndSubArray();
+  Object obj = builder.Done();
+
+  ObjectView array = obj["a"].ValueOf<ObjectView>();
+  ASSERT_EQ(array.NumFields(), 10020);
+  ASSERT_EQ(array["0"].ValueOf<int>(), 1);
+  ASSERT_EQ(array["1"].ValueOf<Slice>().ToString(), "two");
+  ASSERT_EQ(array["2"].ValueOf<ObjectView>()["three"].ValueOf<int>(), 3);
+  ASSERT_EQ(array["3"].ValueOf<ObjectView>()["0"].ValueOf<double>(), 4.5);
+  ASSERT_EQ(array["4"].Type(), kObjectId);
+
+  int i = 0;
+  for (const Element &e : array) {
+    ASSERT_EQ(std::string(e.RawFieldName()), std::to_string(i));
+    if (i >= 5) {
+      ASSERT_EQ(e.ValueOf<int>(), i);
+    }
+    i++;
+  }
+}
+
+TEST(View, Borrowed) {
+  ObjectBuilder builder;
+  builder.Append("i", 42).Append("s", Slice("sunshine boys"));
+  builder.BeginSubObject("o").Append("d", 1.5);
+  builder.EndSubObject();
+  Object obj = builder.Done();
+
+  ASSERT_TRUE(std::is_trivially_copyable<ObjectView>::value);
+
+  // bytes received from somewhere else, e.g a socket.
+  std::string received(obj.RawData(), obj.TotalSize());
+  ObjectView view(received.data());
+  ASSERT_EQ(view.TotalSize(), obj.TotalSize());
+  ASSERT_EQ(view.NumFields(), 3);
+  ASSERT_EQ(view["i"].ValueOf<int>(), 42);
+  ASSERT_EQ(view.find("s")->ValueOf<Slice>().ToString(), "sunshine boys");
+  ASSERT_EQ(view.find("o")->Type(), kObject);
+  ASSERT_FALSE(view.HasMember("x"));
+  ASSERT_EQ(view.Dump(), obj.Dump());
+
+  Object owned = view.Own();
+  ASSERT_NE(owned.RawData(), view.RawData());
+  received.assign(received.size(), '\0');
+  ASSERT_EQ(owned["i"].ValueOf<int>(), 42);
+  ASSERT_EQ(owned.NumFields(), 3);
+}
+
+TEST(View, Own) {
+  ObjectBuilder builder;
+  builder.Append("i", 1);
+  Object obj = builder.Done();
+
+  // Already owned, no copy.
+  ASSERT_EQ(obj.Own().RawData(), obj.RawData());
+
+  Object arenaObj = [] {
+    Arena arena;
+    ObjectBuilder builder(&arena);
+    builder.Append("i", 2);
+    Object owned = builder.Done().Own();
+    EXPECT_EQ(owned.ShareFromThis().use_count(), 1);
+    return owned;
+  }();
+  ASSERT_EQ(arenaObj["i"].ValueOf<int>(), 2);
+}
+
+TEST(View, Embedded) {
+  ObjectBuilder builder;
+  builder.BeginSubObject("o").Append("i", 1);
+  builder.BeginSubObject("oo").Append("s", Slice("deep"));
+  builder.EndSubObject();
+  builder.EndSubObject();
+  builder.BeginSubArray("a").Append("0", 1.5).Append("1", true);
+  builder.EndSubArray();
+  Object obj = builder.Done();
+  builder.Reset();
+
+  // Viewed in place.
+  Element o = obj["o"];
+  ObjectView view = o.ValueOf<ObjectView>();
+  ASSERT_EQ(view.RawData(), o.RawValue());
+  ASSERT_EQ(view["i"].ValueOf<int>(), 1);
+  ASSERT_EQ(view["oo"].ValueOf<ObjectView>()["s"].ValueOf<Slice>().ToString(),
+            "deep");
+  ASSERT_EQ(obj["a"].ValueOf<ObjectView>().NumFields(), 2);
+
+  // Children sharing the ownership of the outer object outlive it.
+  auto embedded = [](const char *field) {
+    ObjectBuilder builder;
+    builder.BeginSubObject("o").Append("i", 1);
+    builder.EndSubObject();
+    builder.BeginSubArray("a").Append("0", 1.5).Append("1", true);
+    builder.EndSubArray();
+    Object parent = builder.Done();
+    return parent.Embedded(parent[field]);
+  };
+  Object sub = embedded("o");
+  Array array(embedded("a"));
+  ASSERT_EQ(sub.ShareFromThis().use_count(), 1);
+  ASSERT_EQ(sub["i"].ValueOf<int>(), 1);
+  ASSERT_EQ(array.ShareFromThis().use_count(), 1);
+  ASSERT_EQ(array.NumFields(), 2);
+  ASSERT_EQ(array["1"].ValueOf<bool>(), true);
+
+  Object shared = obj.Embedded(o);
+  ASSERT_EQ(shared.RawData(), o.RawValue());
+  ASSERT_EQ(obj.ShareFromThis().use_count(), 2);
+}
+
+TEST(View, RefCounting) {
+  for (RefCounting_t counting : {kAtomicRefCount, kNonAtomicRefCount}) {
+    ObjectBuilder builder;
+    builder.SetRefCounting(counting);
+    builder.BeginSubObject("o").Append("i", 1);
+    builder.EndSubObject();
+    Object obj = builder.Done();
+    ASSERT_EQ(obj.ShareFromThis().use_count(), 2);  // by the builder too
+    builder.Reset();
+    ASSERT_EQ(obj.ShareFromThis().use_count(), 1);
+
+    // The reference count lives right in front of the object.
+    {
+      Object copy = obj;
+      ASSERT_EQ(obj.ShareFromThis().use_count(), 2);
+      Object sub(SharedBuffer(copy.ShareFromThis(), obj["o"].RawValue()));
+      ASSERT_EQ(obj.ShareFromThis().use_count(), 3);
+      ASSERT_EQ(sub["i"].ValueOf<int>(), 1);
+    }
+    ASSERT_EQ(obj.ShareFromThis().use_count(), 1);
+
+    Object moved(std::move(obj));
+    ASSERT_EQ(moved.ShareFromThis().use_count(), 1);
+  }
+}
+
+TEST(Index, Find) {
+  ObjectBuilder builder;
+  for (int i = 0; i < 300; i++)
+    builder.Append(std::to_string(i), i);
+  builder.Append("", -1).Append("dup", 1).Append("dup", 2);
+  Object obj = builder.Done(true);
+  ASSERT_TRUE(obj.IsIndexed());
+
+  Object unindexed(obj.ShareFromThis());
+  ASSERT_FALSE(unindexed.IsIndexed());
+
+  for (int i = 0; i < 300; i++) {
+    std::string field = std::to_string(i);
+    ASSERT_EQ(obj[field].ValueOf<int>(), i);
+    ASSERT_TRUE(obj.find(field) == unindexed.find(field));
+  }
+  ASSERT_EQ(obj[""].ValueOf<int>(), -1);
+  ASSERT_EQ(obj["dup"].ValueOf<int>(), 1);
+  ASSERT_FALSE(obj.HasMember("300"));
+  ASSERT_FALSE(obj.HasMember("du"));
+  ASSERT_FALSE(obj.HasMember("dupe"));
+  ASSERT_TRUE(obj.find("300") == obj.end());
+
+  // Copies share the index, views look fields up without it.
+  ObjectView view = obj;
+  Object copy = obj;
+  ASSERT_EQ(view["299"].ValueOf<int>(), 299);
+  ASSERT_TRUE(copy.IsIndexed());
+
+  // A view only needs the bytes to be alive, not the index.
+  Object keep(obj.ShareFromThis());
+  ObjectView outlived;
+  {
+    Object indexed = keep;
+    indexed.BuildIndex();
+    outlived = indexed;
+  }
+  ASSERT_EQ(outlived["299"].ValueOf<int>(), 299);
+  ASSERT_FALSE(outlived.HasMember("300"));
+
+  ObjectBuilder empty;
+  Object emptyObj = empty.Done(true);
+  ASSERT_FALSE(emptyObj.HasMember(""));
+}
+
+TEST(Projection, Project) {
+  ObjectBuilder builder;
+  builder.Append("name", Slice("joe")).Append("age", 30).Append("a", 1);
+  builder.BeginSubObject("address").Append("city", Slice("x"));
+  builder.EndSubObject();
+  builder.Append("ag", 2).Append("age", 31);
+  Object obj = builder.Done();
+
+  static const auto kProjection =
+      MakeProjection("age", "address", "missing", "name", std::string("ag"));
+  Element fields[5];
+  ASSERT_EQ(kProjection.Project(obj, fields), 4u);
+  ASSERT_EQ(fields[0].ValueOf<int>(), 30);
+  ASSERT_EQ(fields[1].Type(), kObject);
+  ASSERT_EQ(fields[2].Type(), kEOO);
+  ASSERT_EQ(fields[3].ValueOf<Slice>().ToString(), "joe");
+  ASSERT_EQ(fields[4].ValueOf<int>(), 2);
+
+  for (int i = 0; i < 5; i++) {
+    auto it = obj.find(kProjection.Field(i));
+    if (it == obj.end())
+      ASSERT_EQ(fields[i].Type(), kEOO);
+    else
+      ASSERT_EQ(fields[i].RawData(), it->RawData());
+  }
+
+  ObjectBuilder empty;
+  ASSERT_EQ(MakeProjection("a").Project(empty.Done(), fields), 0u);
+}
+
+TEST(Append, AllTypes) {
+  ObjectId oid;
+  ASSERT_TRUE(ObjectId::FromString("507f1f77bcf86cd799439011", &oid));
+  ObjectId invalid;
+  ASSERT_FALSE(ObjectId::FromString("507f1f77bcf86cd79943901x", &invalid));
+  ASSERT_FALSE(ObjectId::FromString("507f", &invalid));
+  ASSERT_EQ(oid.ToString(), "507f1f77bcf86cd799439011");
+
+  ObjectBuilder scopeBuilder;
+  scopeBuilder.Append("x", 1);
+  Object scope = scopeBuilder.Done();
+
+  ObjectBuilder builder;
+  builder.Append("oid", oid)
+      .Append("bin", BinData{4, Slice("\x01\x02\x03", 3)})
+      .Append("ts", Timestamp{7, 1500000000})
+      .Append("dec", Decimal128{15, 0x303E000000000000ULL})
+      .Append("re", Regex{"^a.*", "i"})
+      .Append("code", Code{"return 1"})
+      .Append("sym", Symbol{"sym"})
+      .Append("cws", CodeWScope{"return x", scope})
+      .Append("ptr", DBPointer{"db.c", oid})
+      .Append("undef", Undefined())
+      .Append("min", MinKey())
+      .Append("max", MaxKey())
+      .Append("last", 42);
+  Object obj = builder.Done();
+
+  ASSERT_EQ(obj.NumFields(), 13);
+  ASSERT_EQ(obj["oid"].ValueOf<ObjectId>(), oid);
+  BinData bin = obj["bin"].ValueOf<BinData>();
+  ASSERT_EQ(bin.subtype, 4);
+  ASSERT_EQ(bin.data.ToString(), std::string("\x01\x02\x03", 3));
+  ASSERT_EQ(obj["ts"].ValueOf<Timestamp>().seconds, 1500000000u);
+  ASSERT_EQ(obj["ts"].ValueOf<Timestamp>().increment, 7u);
+  ASSERT_EQ(obj["dec"].ValueOf<Decimal128>().ToString(), "1.5");
+  ASSERT_EQ(obj["re"].ValueOf<Regex>().pattern.ToString(), "^a.*");
+  ASSERT_EQ(obj["re"].ValueOf<Regex>().options.ToString(), "i");
+  ASSERT_EQ(obj["code"].ValueOf<Code>().code.ToString(), "return 1");
+  ASSERT_EQ(obj["sym"].ValueOf<Symbol>().symbol.ToString(), "sym");
+  CodeWScope cws = obj["cws"].ValueOf<CodeWScope>();
+  ASSERT_EQ(cws.code.ToString(), "return x");
+  ASSERT_EQ(cws.scope["x"].ValueOf<int>(), 1);
+  ASSERT_EQ(obj["ptr"].ValueOf<DBPointer>().ns.ToString(), "db.c");
+  ASSERT_EQ(obj["ptr"].ValueOf<DBPointer>().id, oid);
+  ASSERT_EQ(obj["undef"].Type(), kUndefined);
+  ASSERT_EQ(obj["min"].Type(), kMinKey);
+  ASSERT_EQ(obj["max"].Type(), kMaxKey);
+
+  // Every element was skipped over correctly.
+  ASSERT_EQ(obj["last"].ValueOf<int>(), 42);
+  size_t total = 4 + 1;
+  for (const Element &e : obj) {
+    ASSERT_TRUE(IsValidType(e.Type()));
+    total += e.Size();
+  }
+  ASSERT_EQ(total, obj.TotalSize());
+}
+
+TEST(Decimal128, ToString) {
+  struct {
+    uint64_t high, low;
+    const char *expected;
+  } cases[] = {
+      {0x3040000000000000ULL, 1, "1"},
+      {0x3040000000000000ULL, 0, "0"},
+      {0xB03E000000000000ULL, 15, "-1.5"},
+      {0x3046000000000000ULL, 1, "1E+3"},
+      {0x3032000000000000ULL, 1, "1E-7"},
+      {0x3034000000000000ULL, 1, "0.000001"},
+      {0x302C73A6A14E603CULL, 0x798A11C0F1E2DF79ULL,
+       "234567890123456789012345.6789012345"},
+      {0x7C00000000000000ULL, 0, "NaN"},
+      {0x7800000000000000ULL, 0, "Infinity"},
+      {0xF800000000000000ULL, 0, "-Infinity"},
+  };
+  for (auto &c : cases)
+    ASSERT_EQ(Decimal128({c.low, c.high}).ToString(), c.expected);
+}
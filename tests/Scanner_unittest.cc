@@ -0,0 +1,207 @@
+/**
+ * Copyright (C) 2016, Wu Tao All rights reserved.
+ *
+ * bson is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bson is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "internal/Scanner.h"
+#include "internal/StructuralIndex.h"
+
+using namespace bson::internal;
+
+// Runs "test" against each implementation of the primitives this cpu
+// supports, then goes back to the best one.
+template <typename Test>
+static void ForEachScanner(Test test) {
+  for (ScannerImpl_t impl : {kScalarScanner, kSSE2Scanner, kAVX2Scanner}) {
+    if (!TEST_UseScanner(impl))
+      continue;
+    SCOPED_TRACE(impl);
+    test();
+    if (::testing::Test::HasFatalFailure())
+      break;
+  }
+  TEST_UseScanner(kBestScanner);
+}
+
+TEST(Scanner, SkipWhitespace) {
+  // Cover the block loops as well as the scalar tails.
+  ForEachScanner([] {
+    for (size_t n = 0; n < 100; n++) {
+      std::string s(n, ' ');
+      for (size_t i = 0; i < n; i++)
+        s[i] = " \t\n\v\f\r"[i % 6];
+
+      ASSERT_EQ(SkipWhitespace(s.data(), s.data() + n), s.data() + n);
+
+      s += "x  ";
+      ASSERT_EQ(SkipWhitespace(s.data(), s.data() + s.size()), s.data() + n);
+    }
+  });
+}
+
+TEST(Scanner, SkipWhitespaceNonSpace) {
+  // Characters next to the whitespace ranges must not be skipped.
+  const char others[] = {'\b', '\x0e', '\x1f', '!', '\x7f',
+                         static_cast<char>(0x80), static_cast<char>(0x89),
+                         static_cast<char>(0xa0), static_cast<char>(0xff)};
+  ForEachScanner([&others] {
+    for (char c : others) {
+      std::string s(40, ' ');
+      s[37] = c;
+      ASSERT_EQ(SkipWhitespace(s.data(), s.data() + s.size()), s.data() + 37);
+    }
+  });
+}
+
+TEST(Scanner, FindQuoteOrEscape) {
+  ForEachScanner([] {
+    for (size_t n = 0; n < 100; n++) {
+      std::string s(n, 'a');
+      ASSERT_EQ(FindQuoteOrEscape(s.data(), s.data() + n, '"'), s.data() + n);
+
+      s += "'\"\\";
+      ASSERT_EQ(FindQuoteOrEscape(s.data(), s.data() + s.size(), '"'),
+                s.data() + n + 1);
+      ASSERT_EQ(FindQuoteOrEscape(s.data(), s.data() + s.size(), '\''),
+                s.data() + n);
+
+      s[n] = s[n + 1] = 'a';
+      ASSERT_EQ(FindQuoteOrEscape(s.data(), s.data() + s.size(), '\''),
+                s.data() + n + 2);
+    }
+  });
+}
+
+// Byte-at-a-time counterpart of StructuralIndex::Build.
+static std::vector<uint32_t> IndexReference(const std::string &s,
+                                            bool *inString) {
+  std::vector<uint32_t> ret;
+  bool escaped = false, in = false, pred = true;
+  for (size_t i = 0; i < s.size(); i++) {
+    char c = s[i];
+    bool quote = (c == '"' && !escaped);
+    escaped = (c == '\\' && !escaped);
+    if (quote)
+      in = !in;
+
+    bool op = c != '\0' && strchr("{}[]:,", c) != nullptr && !in;
+    bool space = IsSpace(c);
+    bool closing = quote && !in;
+    if (op || (quote && in) || (pred && !space && !in && !closing))
+      ret.push_back(static_cast<uint32_t>(i));
+    pred = op || quote || space;
+  }
+  *inString = in;
+  return ret;
+}
+
+TEST(StructuralIndex, Basic) {
+  std::string json = "{ \"a\\\"\" : [1, -2.5e3, true],\"b\":null }";
+  StructuralIndex index;
+  ASSERT_TRUE(index.Build(json).IsOK());
+
+  std::string tokens;
+  for (uint32_t pos : index)
+    tokens.push_back(json[pos]);
+  ASSERT_EQ(tokens, "{\":[1,-,t],\":n}");
+}
+
+TEST(StructuralIndex, Random) {
+  const char alphabet[] = "\"\\ {}[]:,a1\n";
+  ForEachScanner([&alphabet] {
+    std::srand(0);
+    StructuralIndex index;
+
+    for (int round = 0; round < 2000; round++) {
+      std::string s(static_cast<size_t>(std::rand() % 300), ' ');
+      for (char &c : s)
+        c = alphabet[std::rand() % (sizeof(alphabet) - 1)];
+
+      bool inString;
+      std::vector<uint32_t> expected = IndexReference(s, &inString);
+      bool ok = index.Build(s).IsOK();
+      ASSERT_EQ(ok, !inString) << s;
+      if (ok) {
+        std::vector<uint32_t> actual(index.begin(), index.end());
+        ASSERT_EQ(actual, expected) << s;
+      }
+    }
+  });
+}
+
+TEST(StructuralIndex, Unterminated) {
+  StructuralIndex index;
+  ASSERT_TRUE(index.Build("{\"abc\\\": 1}").IsFailedToParse());
+}
+
+TEST(Scanner, DecodeQuoted) {
+  std::string json = "ab\\\"c\\n\\\\\\q\\/'\" tail";
+  std::string result;
+  const char *end = DecodeQuoted(json.data(), json.data() + json.size(), '"',
+                                 [&result](bson::Slice piece) {
+                                   result.append(piece.RawData(), piece.Len());
+                                 });
+  ASSERT_EQ(result, "ab\"c\n\\q/'");
+  ASSERT_EQ(std::string(end), " tail");
+
+  // unterminated
+  json = "abc\\\"";
+  ASSERT_EQ(DecodeQuoted(json.data(), json.data() + json.size(), '"',
+                         [](bson::Slice) {}),
+            nullptr);
+
+  // \u escape sequences are decoded to UTF-8
+  json = "\\u0041\\u00e9\\u20AC\\ud83d\\ude00\"";
+  result.clear();
+  end = DecodeQuoted(json.data(), json.data() + json.size(), '"',
+                     [&result](bson::Slice piece) {
+                       result.append(piece.RawData(), piece.Len());
+                     });
+  ASSERT_EQ(result, "A\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80");
+  ASSERT_EQ(end, json.data() + json.size());
+}
+
+TEST(Scanner, DecodeUnicodeEscape) {
+  char utf8[4];
+  size_t len;
+  std::string esc = "\\u007f\\u0080\\u07FF\\u0800\\uffff\\udbff\\udfff";
+  const char *p = esc.data(), *end = esc.data() + esc.size();
+  const char *expected[] = {"\x7f", "\xc2\x80", "\xdf\xbf", "\xe0\xa0\x80",
+                            "\xef\xbf\xbf", "\xf4\x8f\xbf\xbf"};
+  for (const char *e : expected) {
+    p = DecodeUnicodeEscape(p, end, utf8, &len);
+    ASSERT_TRUE(p != nullptr) << e;
+    ASSERT_EQ(std::string(utf8, len), e);
+  }
+  ASSERT_EQ(p, end);
+
+  const char *invalid[] = {"\\u12",         "\\u12g4",        "\\ud800",
+                           "\\ud800\\u0041", "\\ud800\\ud800", "\\udc00",
+                           "\\ud800\\udc0"};
+  for (const char *s : invalid)
+    ASSERT_EQ(DecodeUnicodeEscape(s, s + strlen(s), utf8, &len), nullptr) << s;
+
+  // Sequences which may be cut by the end of the input
+  for (const char *s : {"\\", "\\u", "\\u12", "\\ud800", "\\ud800\\udc0"})
+    ASSERT_TRUE(IsEscapePrefix(s, s + strlen(s))) << s;
+  for (const char *s : {"\\n", "\\u12g", "\\ud800x", "\\ud800\\udc00"})
+    ASSERT_FALSE(IsEscapePrefix(s, s + strlen(s))) << s;
+}
@@ -34,6 +34,20 @@ TEST(Basic, FailedToParse) {
   ASSERT_EQ(s.ToString(), "FailedToParse: test");
 }
 
+TEST(Basic, IOError) {
+  Status s = Status::IOError("test");
+  ASSERT_EQ(s.IsIOError(), true);
+  ASSERT_EQ(s.IsFailedToParse(), false);
+  ASSERT_EQ(s.ToString(), "IOError: test");
+}
+
+TEST(Basic, Corruption) {
+  Status s = Status::Corruption("test");
+  ASSERT_EQ(s.IsCorruption(), true);
+  ASSERT_EQ(s.IsIOError(), false);
+  ASSERT_EQ(s.ToString(), "Corruption: test");
+}
+
 TEST(Basic, Copy) {
   Status s = Status::FailedToParse("test");
   ASSERT_EQ(s.IsOK(), false);